@@ -0,0 +1,151 @@
+// 4 KB pages against transparent huge pages for the mmap-backed rings of
+// dsp/Memory.h, the comparison behind --hugepages.
+//
+//   bench_arena [MB]
+//
+// Maps a region (64 MB by default) each way and runs two patterns over it:
+// a ring stream, block-sized copies in and out as the IQ queue does, and
+// dependent reads at scattered cache lines, which is where TLB reach shows.
+// Each figure is the best of five. dTLB load misses are read through
+// perf_event_open when the kernel allows it (user space only); otherwise
+// the bench says so and reports times alone.
+#include "LatencyStats.h"
+#include "dsp/Memory.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <random>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+static constexpr size_t BLOCK = 262144;   // one USB transfer
+static constexpr size_t HOPS = 4000000;
+
+// dTLB read misses of this thread, user space only; -1 when unavailable.
+class TlbCounter {
+public:
+  TlbCounter() {
+    perf_event_attr a{};
+    a.size = sizeof(a);
+    a.type = PERF_TYPE_HW_CACHE;
+    a.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+               (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    a.disabled = 1;
+    a.exclude_kernel = 1;
+    a.exclude_hv = 1;
+    fd_ = int(syscall(SYS_perf_event_open, &a, 0, -1, -1, 0));
+    if (fd_ < 0) err_ = errno;
+  }
+  ~TlbCounter() {
+    if (fd_ >= 0) close(fd_);
+  }
+  bool ok() const { return fd_ >= 0; }
+  const char* error() const { return std::strerror(err_); }
+  void start() {
+    if (fd_ < 0) return;
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  long long stop() {
+    if (fd_ < 0) return -1;
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    long long v = 0;
+    if (read(fd_, &v, sizeof(v)) != ssize_t(sizeof(v))) return -1;
+    return v;
+  }
+
+private:
+  int fd_ = -1;
+  int err_ = 0;
+};
+
+// Anonymous memory of this process backed by transparent huge pages.
+static long anon_huge_kb() {
+  FILE* f = std::fopen("/proc/self/smaps_rollup", "r");
+  if (!f) return -1;
+  char line[256];
+  long kb = -1;
+  while (std::fgets(line, sizeof(line), f)) {
+    if (std::sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) break;
+  }
+  std::fclose(f);
+  return kb;
+}
+
+struct Result {
+  long huge_kb = -1;
+  double stream_gbs = 0.0;
+  double hop_ns = 1e30;
+  long long hop_misses = -1;
+};
+
+static Result run(size_t bytes, HugePages hp, TlbCounter& tlb) {
+  Result r;
+  MemRegion mem;
+  if (!mem.map(bytes, hp, -1, hp == HugePages::Off ? "4 KB pages" : "huge pages")) return r;
+  uint8_t* p = static_cast<uint8_t*>(mem.data());
+  std::memset(p, 1, bytes);
+  r.huge_kb = anon_huge_kb();
+  std::vector<uint8_t> blk(BLOCK, 2), out(BLOCK);
+
+  // ring stream: write a block at the head, read one back at the tail
+  const size_t laps = 4;
+  for (int rep = 0; rep < 5; ++rep) {
+    uint64_t t0 = mono_ns();
+    for (size_t k = 0; k < laps * (bytes / BLOCK); ++k) {
+      size_t at = (k * BLOCK) % bytes;
+      std::memcpy(p + at, blk.data(), BLOCK);
+      std::memcpy(out.data(), p + (at + bytes / 2) % bytes, BLOCK);
+    }
+    double s = double(mono_ns() - t0) * 1e-9;
+    r.stream_gbs = std::max(r.stream_gbs, 2.0 * double(laps * bytes) / s / 1e9);
+  }
+
+  // a random cycle through every 64th cache line, each hop a dependent load
+  const size_t lines = bytes / 64;
+  std::vector<size_t> order(lines);
+  for (size_t i = 0; i < lines; ++i) order[i] = i;
+  std::shuffle(order.begin(), order.end(), std::mt19937_64(1));
+  size_t* slot = reinterpret_cast<size_t*>(p);
+  for (size_t i = 0; i < lines; ++i) slot[order[i] * 8] = order[(i + 1) % lines] * 8;
+  for (int rep = 0; rep < 5; ++rep) {
+    size_t at = order[0] * 8;
+    tlb.start();
+    uint64_t t0 = mono_ns();
+    for (size_t h = 0; h < HOPS; ++h) at = slot[at];
+    double ns = double(mono_ns() - t0) / double(HOPS);
+    long long m = tlb.stop();
+    if (at == size_t(-1)) std::printf("\n");   // keeps the chain live
+    if (ns < r.hop_ns) {
+      r.hop_ns = ns;
+      r.hop_misses = m;
+    }
+  }
+  return r;
+}
+
+int main(int argc, char** argv) {
+  size_t mb = argc > 1 ? size_t(std::atol(argv[1])) : 64;
+  if (mb < 4) {
+    std::fprintf(stderr, "Usage: bench_arena [MB >= 4]\n");
+    return 1;
+  }
+  size_t bytes = mb << 20;
+  TlbCounter tlb;
+  if (!tlb.ok()) std::printf("dTLB counters unavailable (perf_event_open: %s); times only\n", tlb.error());
+
+  std::printf("%zu MB region, ring stream in %zu KB blocks, %zu dependent reads:\n", mb, BLOCK / 1024, HOPS);
+  for (HugePages hp : {HugePages::Off, HugePages::Transparent}) {
+    Result r = run(bytes, hp, tlb);
+    std::printf("  %-12s stream %5.1f GB/s  scattered read %5.1f ns", hp == HugePages::Off ? "4 KB pages" : "THP",
+                r.stream_gbs, r.hop_ns);
+    if (r.hop_misses >= 0) std::printf("  dTLB misses %.3f per read", double(r.hop_misses) / double(HOPS));
+    std::printf("  (AnonHugePages %ld MB)\n", r.huge_kb / 1024);
+  }
+  return 0;
+}
@@ -0,0 +1,254 @@
+// Interleaved against split I/Q kernels, the comparison behind dsp/SplitIQ.h.
+//
+//   bench_split_iq [samples]
+//
+// The interleaved side is the pre-split implementation, kept here as the
+// reference: a circular complex delay line per FIR, and a discriminator that
+// works on std::complex samples with a branchy polynomial atan2. The split
+// side is the current FIRDecimatorC, FIRDecimatorXlate and FMDemodulator.
+// 161 taps, decimate by 10, 1M samples by default fed in transfer-sized
+// blocks as the receiver does; best of five runs, scratch already allocated.
+// Exits non-zero if the two sides disagree by more than 1e-5.
+#include "FMDemodulator.h"
+#include "LatencyStats.h"
+#include "dsp/FIRDecimator.h"
+#include "dsp/FirDesign.h"
+#include "dsp/SplitIQ.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+static constexpr int NTAPS = 161;
+static constexpr uint32_t DECIM = 10;
+static constexpr double FS = 9600000.0;
+static constexpr double OFFSET_HZ = 250000.0;
+static constexpr size_t BLOCK = 131072;   // one 256 KB USB transfer
+
+namespace ref {
+
+class FirC {
+public:
+  FirC(const std::vector<float>& taps, uint32_t decim) : taps_(taps), delay_(taps.size()), decim_(decim) {}
+  size_t process(const std::complex<float>* in, size_t n_in, std::complex<float>* out) {
+    size_t out_n = 0, nt = taps_.size();
+    for (size_t i = 0; i < n_in; ++i) {
+      delay_[di_] = in[i];
+      di_ = (di_ + 1) % nt;
+      if (phase_ == 0) {
+        std::complex<float> acc(0, 0);
+        size_t idx = di_;
+        for (size_t k = 0; k < nt; ++k) {
+          idx = (idx == 0) ? (nt - 1) : (idx - 1);
+          acc += delay_[idx] * taps_[k];
+        }
+        out[out_n++] = acc;
+      }
+      if (++phase_ >= decim_) phase_ = 0;
+    }
+    return out_n;
+  }
+
+private:
+  std::vector<float> taps_;
+  std::vector<std::complex<float>> delay_;
+  size_t di_ = 0;
+  uint32_t decim_, phase_ = 0;
+};
+
+class Xlate {
+public:
+  Xlate(const std::vector<float>& taps, uint32_t decim, double fs, double offset_hz)
+    : taps_(taps.size()), delay_(taps.size()), decim_(decim) {
+    double w = 2.0 * M_PI * offset_hz / fs;
+    for (size_t k = 0; k < taps.size(); ++k) taps_[k] = std::complex<float>(std::polar(double(taps[k]), w * double(k)));
+    double wd = std::remainder(w * double(decim_), 2.0 * M_PI);
+    rotate_ = std::fabs(wd) > 1e-9;
+    rot_step_ = std::polar(1.0, -wd);
+  }
+  size_t process(const std::complex<float>* in, size_t n_in, std::complex<float>* out) {
+    size_t out_n = 0, nt = taps_.size();
+    for (size_t i = 0; i < n_in; ++i) {
+      delay_[di_] = in[i];
+      di_ = (di_ + 1) % nt;
+      if (phase_ == 0) {
+        std::complex<float> acc(0, 0);
+        size_t idx = di_;
+        for (size_t k = 0; k < nt; ++k) {
+          idx = (idx == 0) ? (nt - 1) : (idx - 1);
+          acc += delay_[idx] * taps_[k];
+        }
+        if (rotate_) {
+          acc *= std::complex<float>(rot_);
+          rot_ *= rot_step_;
+          rot_ /= std::abs(rot_);
+        }
+        out[out_n++] = acc;
+      }
+      if (++phase_ >= decim_) phase_ = 0;
+    }
+    return out_n;
+  }
+
+private:
+  std::vector<std::complex<float>> taps_;
+  std::vector<std::complex<float>> delay_;
+  size_t di_ = 0;
+  uint32_t decim_, phase_ = 0;
+  std::complex<double> rot_{1.0, 0.0}, rot_step_{1.0, 0.0};
+  bool rotate_ = false;
+};
+
+static inline float fast_atan2(float y, float x) {
+  const float ax = std::fabs(x), ay = std::fabs(y);
+  const float mx = std::max(ax, ay), mn = std::min(ax, ay);
+  if (mx == 0.0f) return 0.0f;
+  const float z = mn / mx;
+  const float z2 = z * z;
+  float a = z * (0.99997726f + z2 * (-0.33262347f + z2 * (0.19354346f +
+            z2 * (-0.11643287f + z2 * (0.05265332f - 0.01172120f * z2)))));
+  if (ay > ax) a = float(M_PI / 2.0) - a;
+  if (x < 0.0f) a = float(M_PI) - a;
+  return (y < 0.0f) ? -a : a;
+}
+
+class Discriminator {
+public:
+  explicit Discriminator(bool fast) : fast_(fast) {}
+  size_t process(const std::complex<float>* in, size_t n, float* out) {
+    for (size_t i = 0; i < n; ++i) {
+      std::complex<float> x = in[i];
+      if (!have_prev_) {
+        prev_ = x;
+        have_prev_ = true;
+        out[i] = 0.0f;
+        continue;
+      }
+      float re = (prev_.real() * x.real()) + (prev_.imag() * x.imag());
+      float im = (prev_.real() * x.imag()) - (prev_.imag() * x.real());
+      out[i] = fast_ ? fast_atan2(im, re) : std::atan2(im, re);
+      prev_ = x;
+    }
+    return n;
+  }
+
+private:
+  bool fast_;
+  std::complex<float> prev_{1.0f, 0.0f};
+  bool have_prev_ = false;
+};
+
+}  // namespace ref
+
+// Best of five, in ms.
+static double time_ms(const std::function<void()>& f) {
+  double best = 1e30;
+  for (int r = 0; r < 5; ++r) {
+    uint64_t t0 = mono_ns();
+    f();
+    best = std::min(best, double(mono_ns() - t0) / 1e6);
+  }
+  return best;
+}
+
+static float max_diff(const std::complex<float>* a, ConstSplitIQView b, size_t n) {
+  float d = 0.0f;
+  for (size_t k = 0; k < n; ++k) d = std::max({d, std::fabs(a[k].real() - b.i[k]), std::fabs(a[k].imag() - b.q[k])});
+  return d;
+}
+
+static void report(const char* what, double t_ref, double t_split, float diff) {
+  std::printf("  %-26s interleaved %6.1f ms  split %6.1f ms  (%.1fx)  max diff %.1e\n", what, t_ref, t_split,
+              t_ref / t_split, double(diff));
+}
+
+int main(int argc, char** argv) {
+  size_t n = argc > 1 ? size_t(std::atol(argv[1])) : 1000000;
+  if (n < 1000) {
+    std::fprintf(stderr, "Usage: bench_split_iq [samples >= 1000]\n");
+    return 1;
+  }
+  // an FM carrier off centre, as the channel filter sees it
+  std::vector<std::complex<float>> x(n);
+  SplitIQBuffer xs(n);
+  double ph = 0.0;
+  for (size_t k = 0; k < n; ++k) {
+    ph += 2.0 * M_PI * (OFFSET_HZ + 75000.0 * std::sin(2.0 * M_PI * 1000.0 * double(k) / FS)) / FS;
+    x[k] = std::polar(0.5f, float(std::remainder(ph, 2.0 * M_PI)));
+    xs.i()[k] = x[k].real();
+    xs.q()[k] = x[k].imag();
+  }
+  auto taps = design_lowpass(float(FS), 100000.0f, NTAPS);
+  size_t n_out = n / DECIM + 8;
+  std::vector<std::complex<float>> ro(n_out);
+  SplitIQBuffer so(n_out);
+  float worst = 0.0f;
+
+  std::printf("%zu samples in blocks of %zu, %d taps, decimate by %u:\n", n, BLOCK, NTAPS, DECIM);
+  {
+    size_t m = 0;
+    FIRDecimatorC f(taps, DECIM);
+    double t_ref = time_ms([&] {
+      ref::FirC r(taps, DECIM);
+      m = 0;
+      for (size_t o = 0; o < n; o += BLOCK) m += r.process(x.data() + o, std::min(BLOCK, n - o), ro.data() + m);
+    });
+    double t_split = time_ms([&] {
+      f.reset();
+      size_t k = 0;
+      for (size_t o = 0; o < n; o += BLOCK) {
+        size_t b = std::min(BLOCK, n - o);
+        k += f.process({xs.i() + o, xs.q() + o, b}, so.view(k, n_out - k));
+      }
+    });
+    float d = max_diff(ro.data(), so.cview(m), m);
+    worst = std::max(worst, d);
+    report("FIR decimator", t_ref, t_split, d);
+  }
+  {
+    size_t m = 0;
+    FIRDecimatorXlate f(taps, DECIM, FS, OFFSET_HZ);
+    double t_ref = time_ms([&] {
+      ref::Xlate r(taps, DECIM, FS, OFFSET_HZ);
+      m = 0;
+      for (size_t o = 0; o < n; o += BLOCK) m += r.process(x.data() + o, std::min(BLOCK, n - o), ro.data() + m);
+    });
+    double t_split = time_ms([&] {
+      f.reset();
+      size_t k = 0;
+      for (size_t o = 0; o < n; o += BLOCK) {
+        size_t b = std::min(BLOCK, n - o);
+        k += f.process({xs.i() + o, xs.q() + o, b}, so.view(k, n_out - k));
+      }
+    });
+    float d = max_diff(ro.data(), so.cview(m), m);
+    worst = std::max(worst, d);
+    report("Xlate decimator", t_ref, t_split, d);
+  }
+  std::vector<float> da(n), db(n);
+  for (bool fast : {true, false}) {
+    FMDemodulator dm;
+    dm.set_fast(fast);
+    double t_ref = time_ms([&] {
+      ref::Discriminator r(fast);
+      for (size_t o = 0; o < n; o += BLOCK) r.process(x.data() + o, std::min(BLOCK, n - o), da.data() + o);
+    });
+    double t_split = time_ms([&] {
+      dm.reset();
+      for (size_t o = 0; o < n; o += BLOCK) {
+        size_t b = std::min(BLOCK, n - o);
+        dm.process({xs.i() + o, xs.q() + o, b}, db.data() + o, b);
+      }
+    });
+    float d = 0.0f;
+    for (size_t k = 0; k < n; ++k) d = std::max(d, std::fabs(da[k] - db[k]));
+    worst = std::max(worst, d);
+    report(fast ? "discriminator, fast atan2" : "discriminator, std::atan2", t_ref, t_split, d);
+  }
+  bool ok = worst <= 1e-5f;
+  std::printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
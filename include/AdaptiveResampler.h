@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include "AudioBroadcast.h"
+#include "dsp/Resampler.h"
+
+// Pulls PCM from an AudioReader at the sink's own clock and stretches it
+// by a few ppm so the ring fill level stays at a fixed target. A PI loop on
+// the (smoothed) fill error steers one Farrow resampler per channel, all at
+// the same ratio; its integrator is the estimated producer/sink clock
+// offset. No samples are dropped or repeated.
+class AdaptiveResampler {
+public:
+  // Channels are the reader's; frames interleave them.
+  AdaptiveResampler(AudioReader& in, double fs, double target_fill_ms);
+
+  // Blocks until enough input is buffered to start at the target fill.
+  bool prime();
+  // Produces exactly n frames (blocking on the ring if it runs dry).
+  // Returns fewer only when the ring is stopped.
+  size_t pull(int16_t* out, size_t n, uint64_t& t_ns);
+
+  // Estimated producer clock offset relative to the sink, in ppm.
+  double drift_ppm() const { return ppm_est_; }
+  double fill_ms() const { return fill_ms_; }
+
+private:
+  void update_loop(size_t produced);
+
+  AudioReader& in_;
+  size_t ch_ = 1;
+  double fs_ = 48000.0;
+  double target_ = 0.0;       // frames
+  double fill_f_ = 0.0;       // smoothed fill, frames
+  double integ_ = 0.0;        // ppm
+
+  // per channel; the same ratio and input count keep them in step
+  std::vector<FarrowResamplerR> farrow_;
+  std::vector<std::vector<float>> pend_;   // popped but not yet consumed input
+  size_t pend_n_ = 0;                      // frames
+  std::vector<int16_t> tmp_;
+  std::vector<std::vector<float>> outf_;
+
+  std::atomic<double> ppm_est_{0.0};
+  std::atomic<double> fill_ms_{0.0};
+};
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "dsp/Memory.h"
+
+class AudioBroadcast;
+
+// What a reader does when it falls more than its max lag behind the writer.
+enum class AudioOverrun {
+  DropOldest,   // skip just enough to be max lag behind (keeps the most audio)
+  Resync,       // jump to the newest sample (lowest latency afterwards)
+};
+
+// One consumer's cursor into an AudioBroadcast. Readers never hold the
+// writer back for longer than one copy: a reader that falls behind loses
+// samples (counted in dropped()), the others are unaffected. Each reader
+// belongs to one thread.
+class AudioReader {
+public:
+  // Copies up to max_count samples at the cursor into out. pop() blocks
+  // until data or stop, pop_for() up to timeout_ms; 0 if none. t_ns:
+  // capture timestamp of the last sample (0 if unknown), see LatencyStats.h.
+  size_t pop(int16_t* out, size_t max_count, uint64_t& t_ns);
+  size_t pop_for(int16_t* out, size_t max_count, uint64_t& t_ns, int timeout_ms);
+  size_t available();
+  // Blocks until at least n samples are queued; false if stopped first.
+  bool wait_for(size_t n);
+  // Wakes this reader; it still returns what is queued, then 0.
+  void stop();
+
+  const std::string& name() const { return name_; }
+  uint16_t channels() const;
+  uint64_t dropped() const { return dropped_; }
+
+private:
+  friend class AudioBroadcast;
+  AudioReader(AudioBroadcast& b, std::string name, size_t max_lag, AudioOverrun policy, uint64_t start)
+    : b_(b), name_(std::move(name)), max_lag_(max_lag), policy_(policy), r_(start) {}
+  // With b_.m_ held.
+  void catch_up();
+  bool ready() const;
+
+  AudioBroadcast& b_;
+  std::string name_;
+  size_t max_lag_;
+  AudioOverrun policy_;
+  uint64_t r_;                   // absolute read position
+  bool stopped_ = false;
+  std::atomic<uint64_t> dropped_{0};
+};
+
+// Single-writer, multi-reader PCM ring. The writer copies each block in
+// once; readers each keep their own cursor and copy out under the ring's
+// lock, so a read never overlaps the writer overwriting the same samples.
+// Samples are interleaved frames of `channels`.
+class AudioBroadcast {
+public:
+  explicit AudioBroadcast(size_t capacity_samples = 48000 * 5, uint16_t channels = 1,
+                          HugePages hp = HugePages::Off);
+  // Maps the ring; false (logged) when that fails. Call before push().
+  bool init();
+
+  // max_lag_samples: 0 = the whole ring. A reader starts at the newest
+  // sample; add readers before the writer starts to see everything.
+  AudioReader& add_reader(const std::string& name, size_t max_lag_samples = 0,
+                          AudioOverrun policy = AudioOverrun::DropOldest);
+
+  // t_ns: capture timestamp of the block (0 = unknown)
+  void push(const int16_t* samples, size_t count, uint64_t t_ns = 0);
+  // Wakes every reader; each still drains what is queued.
+  void stop();
+
+  uint16_t channels() const { return ch_; }
+  const std::vector<std::unique_ptr<AudioReader>>& readers() const { return readers_; }
+
+private:
+  friend class AudioReader;
+  uint64_t mark_for(uint64_t end) const;
+
+  MemRegion mem_;
+  int16_t* buf_ = nullptr;   // in mem_
+  size_t cap_ = 0;
+  uint16_t ch_ = 1;
+  HugePages hp_;
+
+  uint64_t w_total_ = 0;     // samples published
+  uint64_t tail_ = 0;        // oldest sample not (being) overwritten
+  // (absolute write count at end of push, timestamp)
+  std::deque<std::pair<uint64_t, uint64_t>> marks_;
+
+  std::vector<std::unique_ptr<AudioReader>> readers_;
+  bool stopped_ = false;
+  std::mutex m_;
+  std::condition_variable cv_;
+};
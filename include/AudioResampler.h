@@ -2,11 +2,16 @@
 #include <cstddef>
 #include <cstdint>
 #include <vector>
+#include "Config.h"
 #include "dsp/FIRDecimator.h"
+#include "dsp/Resampler.h"
 
+// De-emphasis, audio lowpass and conversion from the MPX rate to exactly
+// fs_out. Picks an integer decimator, a rational L/M polyphase resampler or
+// a Farrow stage depending on the ratio.
 class AudioResampler {
 public:
-  AudioResampler(double fs_in, uint32_t decim_to_48k, float deemph_tau_s, float audio_cut_hz);
+  AudioResampler(double fs_in, double fs_out, float deemph_tau_s, float audio_cut_hz);
   void reset();
 
   size_t process(const float* in_mpx, size_t n_in,
@@ -15,17 +20,36 @@ public:
   double fs_out() const;
   void set_audio_gain(float g);
 
+  // Switch to shorter filters under CPU overload.
+  void set_low_cost(bool en);
+
 private:
+  enum class Mode { Integer, Rational, Farrow };
+
+  struct Filters {
+    FIRDecimatorR dec;        // Integer: lowpass + decimate; Farrow: lowpass + pre-decimate
+    RationalResamplerR rat;
+    FarrowResamplerR farrow;
+    void reset() { dec.reset(); rat.reset(); farrow.reset(); }
+  };
+  void build(Filters& f, int ntaps, int taps_per_phase);
+
   double fs_in_ = 0;
   double fs_out_ = 0;
-  uint32_t decim_ = 1;
+  Mode mode_ = Mode::Integer;
+  uint32_t L_ = 1, M_ = 1, D_ = 1;
+  float cut_ = 0.0f;
 
   float a_ = 0.0f;
   float y_ = 0.0f;
 
-  float gain_ = 0.8f;
+  float scale_ = 1.0f;
+  float gain_ = DEFAULT_AUDIO_GAIN;
 
-  FIRDecimatorR dec_;
-  std::vector<float> tmp_;
-  std::vector<float> tmp2_;
+  Filters full_;
+  Filters lite_;
+  Filters* f_ = &full_;
+  AlignedFloats tmp_;
+  AlignedFloats tmp2_;
+  AlignedFloats tmp3_;
 };
@@ -0,0 +1,43 @@
+#pragma once
+#include "Config.h"
+#include "IQSource.h"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ScanResult {
+  double freq_hz = 0;
+  float power_db = 0;   // channel power, dBFS
+  float snr_db = 0;     // above the band noise floor
+  uint16_t pi = 0;      // RDS, 0 if not decoded
+  std::string ps;
+};
+
+// Sweeps 87.5-108 MHz at the widest HackRF span in as few retunes as
+// possible, averages windowed FFT power spectra per step and reports
+// carriers on the 100 kHz raster. Optionally dwells to decode RDS PI/PS
+// from the IQ already captured for that step.
+class BandScanner {
+public:
+  explicit BandScanner(const ReceiverConfig& cfg);
+
+  bool run(std::vector<ScanResult>& out);
+
+private:
+  // Skips `skip` bytes, then copies `want` bytes of IQ.
+  bool capture(size_t skip, size_t want, std::vector<uint8_t>& buf);
+  void on_iq(const uint8_t* iq, size_t bytes);
+  void decode_rds(const std::vector<uint8_t>& raw, double lo_hz, ScanResult& r);
+
+  ReceiverConfig cfg_;
+  std::unique_ptr<IQSource> dev_;   // cfg.device, as for a receiver
+
+  std::mutex m_;
+  std::condition_variable cv_;
+  std::vector<uint8_t>* cap_buf_ = nullptr;
+  size_t cap_skip_ = 0;
+  size_t cap_want_ = 0;
+};
@@ -2,20 +2,49 @@
 #include <complex>
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 #include "dsp/FIRDecimator.h"
 
 class ChannelFilter {
 public:
-  ChannelFilter(double fs_in, uint32_t decim, float cut_hz);
+  // offset_hz != 0: the wanted channel sits at +offset_hz in the input and is
+  // translated to DC inside the decimating filter (offset tuning).
+  ChannelFilter(double fs_in, uint32_t decim, float cut_hz, double offset_hz = 0.0);
+
+  // Picks the RF decimation for fs_in: prefers an MPX rate that is an integer
+  // multiple of fs_audio, otherwise the lowest MPX rate >= 176 kHz.
+  static uint32_t auto_decim(double fs_in, double fs_audio);
+  // Smallest tuning offset >= 250 kHz that is a multiple of the output rate
+  // and keeps the channel in band; 0 if none fits.
+  static double auto_offset(double fs_in, uint32_t decim, float cut_hz);
 
   size_t process(const std::complex<float>* in, size_t n_in,
                  std::complex<float>* out, size_t out_cap);
+  size_t process(ConstSplitIQView in, SplitIQView out);
 
   double fs_out() const;
+  uint32_t decim() const { return decim_; }
+  double offset_hz() const { return offset_hz_; }
+
+  // Clears filter history, keeping the tuning.
+  void reset();
+
+  // Retune within the captured span: re-rotates the taps and clears history.
+  void set_offset(double offset_hz);
+
+  // Switch to a shorter (wider transition) filter under CPU overload.
+  void set_low_cost(bool en);
 
 private:
   double fs_in_ = 0;
   double fs_out_ = 0;
   uint32_t decim_ = 1;
+  double offset_hz_ = 0.0;
+  std::vector<float> taps_;
+  std::vector<float> taps_lc_;
   FIRDecimatorC dec_;
+  FIRDecimatorC dec_lc_;
+  FIRDecimatorXlate xl_;
+  FIRDecimatorXlate xl_lc_;
+  bool low_cost_ = false;
 };
@@ -1,8 +1,17 @@
 #pragma once
+#include "dsp/Memory.h"
 #include <cstdint>
 #include <string>
+#include <vector>
+
+// Audio gain until the control socket changes it: 75 kHz deviation comes
+// out at 0.8 of PCM full scale, leaving headroom for overdeviation.
+static constexpr float DEFAULT_AUDIO_GAIN = 0.8f;
 
 struct ReceiverConfig {
+  // IQ source: "" for the first HackRF, a HackRF serial number,
+  // "file:<path>" (raw int8 IQ, looped) or "synth[:<MHz>]" (test carrier).
+  std::string device;
   double rf_freq_hz = 99.9e6;
   double sample_rate_hz = 9.6e6;
 
@@ -12,17 +21,91 @@ struct ReceiverConfig {
   uint32_t lna_gain_db = 16;
   uint32_t vga_gain_db = 20;
 
+  // Processing block size in IQ bytes (must be even). Smaller blocks cut
+  // latency at some CPU cost; --low-latency selects 16 KB (~0.85 ms at 9.6 MS/s).
+  // IQ still arrives in 256 KB USB transfers (IQSource.h), which sets the floor.
+  uint32_t block_bytes = 262144;
+
+  // Step down quality tiers (RDS, filter length, discriminator) when the
+  // worker cannot keep up, instead of overwriting IQ.
+  bool auto_degrade = true;
+
   // DSP
-  uint32_t rf_decim = 50;          // 9.6e6 / 50 = 192000
-  uint32_t audio_decim = 4;        // 192000 / 4 = 48000
+  // RF decimation to the MPX rate; 0 picks one for sample_rate_hz
+  // (9.6e6 / 50 = 192000, 2.4e6 / 10 = 240000, 4e6 / 22 = 181818.18).
+  // The audio stage then resamples MPX to exactly audio_rate_hz.
+  uint32_t rf_decim = 0;
+  double audio_rate_hz = 48000.0;
   float channel_cut_hz = 100000.0f;
   float deemph_tau_s = 50e-6f;     // Riyadh typically follows ITU Region 1 (50 us)
   float audio_cut_hz = 16000.0f;
+  // Offset tuning: tune the HackRF below the station and translate the
+  // channel to DC inside the channel filter. tune_offset_hz = 0 picks one.
+  bool offset_tune = false;
+  double tune_offset_hz = 0.0;
+  // Pilot-locked stereo with mono fallback; audio becomes interleaved L/R.
+  bool stereo = false;
+  // Carrier squelch: skip demod, RDS and audio while the channel is dead.
+  // Closed channels emit silence, or nothing when squelch_silence is false.
+  bool squelch = false;
+  float squelch_db = -60.0f;       // channel power to open, dBFS
+  float squelch_hyst_db = 3.0f;
+  double squelch_hang_s = 0.3;
+  bool squelch_silence = true;
+
+  // Pipeline stages on one thread each instead of all on one thread; pays
+  // off only with a spare core per busy stage.
+  bool graph_threads = false;
+  // Real-time: CPU pinning (-1 leaves affinity alone) and SCHED_FIFO.
+  // DSP blocks take cpu_dsp round-robin (one thread: the first entry).
+  // rt_prio > 0 runs DSP threads at that FIFO priority, the USB thread one
+  // above and sink threads one below.
+  std::vector<int> cpu_dsp;
+  int cpu_usb = -1;
+  int cpu_sink = -1;
+  int rt_prio = 0;
+  bool mlock = false;
+  // Touch the IQ queue and every chunk pool before streaming starts.
+  bool prefault = false;
+  // Pages for the IQ ring and audio rings (dsp/Memory.h).
+  HugePages huge_pages = HugePages::Off;
 
   // Output
   std::string wav_path = "out.wav";
   bool write_wav = true;
+  // Demodulated MPX capture (MpxFile.h), empty for none; int16 unless mpx_f16.
+  std::string mpx_path;
+  bool mpx_f16 = false;
+  // Spectrum monitor taps (SpectrumMonitor.h) on the wideband IQ and on the
+  // channel: a file path or "udp:<IPv4>:<port>", empty for none.
+  std::string spectrum_iq;
+  std::string spectrum_ch;
+  size_t spectrum_fft = 1024;
+  double spectrum_rate_hz = 5.0;
+  int spectrum_avg = 8;
+  double spectrum_budget = 0.03;   // fraction of one core per tap
 
   // RDS
   bool enable_rds = true;
+  // Run the RDS decoder only while a subcarrier is detected (RdsDetector.h).
+  bool rds_auto = false;
+  // Archive every decoded group here (RdsArchive.h), empty for none.
+  std::string rds_archive_dir;
+
+  // Band scan (--scan): widest HackRF rate, optional RDS dwell per step
+  double scan_rate_hz = 20e6;
+  bool scan_rds = false;
+  double scan_dwell_s = 1.0;
+
+  // RTP relay: "host:port" entries, unicast or multicast
+  std::vector<std::string> rtp_dests;
+  double rtp_packet_ms = 5.0;
+  int rtp_ttl = 1;
+  // Pace RTP on the host clock and track HackRF/host drift with an adaptive
+  // resampler holding rtp_fill_ms of audio buffered.
+  bool rtp_paced = false;
+  double rtp_fill_ms = 40.0;
+
+  // Live control (ControlServer.h): Unix socket path, empty for none.
+  std::string control_socket;
 };
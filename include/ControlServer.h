@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+class FMReceiver;
+
+// Live control over a Unix-domain stream socket, one command per line:
+//   freq <MHz>      lna <dB>      vga <dB>      gain <x>
+//   rds on|off      status
+// Changes reach the pipeline at the next block boundary (ChunkTag), not
+// from this thread. Each reply is one line: "ok <cmd> <ms> ms" once the
+// change is audible at the audio output (the RDS decoder for "rds"),
+// "ok <cmd> applied, not observed in <ms> ms" if nothing came out in time
+// (squelched, stopped), "err <reason>", or for status
+//   "ok freq <MHz> lna <dB> vga <dB> gain <x> rds on|off ps <PS>".
+// Commands are served one at a time, in arrival order.
+class ControlServer {
+public:
+  explicit ControlServer(FMReceiver& rx);
+  ~ControlServer();
+
+  // Replaces a stale socket file at path.
+  bool start(const std::string& path);
+  void stop();
+
+  uint64_t commands() const { return commands_; }
+
+private:
+  void worker();
+  std::string handle(const std::string& line);
+
+  FMReceiver& rx_;
+  std::string path_;
+  int fd_ = -1;
+  int wake_[2] = {-1, -1};          // stop() -> worker
+  std::atomic<bool> running_{false};
+  std::thread th_;
+  std::atomic<uint64_t> commands_{0};
+};
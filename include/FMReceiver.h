@@ -1,60 +1,184 @@
 #pragma once
 #include "Config.h"
-#include "HackRFDevice.h"
-#include "AudioRingBuffer.h"
+#include "IQSource.h"
+#include "AudioBroadcast.h"
 #include "ChannelFilter.h"
 #include "FMDemodulator.h"
 #include "AudioResampler.h"
+#include "StereoDecoder.h"
 #include "RDSDecoder.h"
+#include "LatencyStats.h"
+#include "OverloadGovernor.h"
+#include "Squelch.h"
+#include "MpxFile.h"
+#include "RdsArchive.h"
+#include "SpectrumMonitor.h"
+#include "flow/Blocks.h"
+#include "dsp/Memory.h"
 #include <complex>
+#include <memory>
 #include <thread>
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <vector>
 #include <string>
 
+// What became of a live control change (FMReceiver::wait_control).
+enum class ControlResult {
+  Applied,   // audio (or RDS) leaving the pipeline reflects it
+  Failed,    // the device rejected it; the previous setting stays
+  Timeout,   // not observed in time, or the receiver stopped
+};
+
 class FMReceiver {
 public:
-  FMReceiver(const ReceiverConfig& cfg, AudioRingBuffer& audio_out);
+  FMReceiver(const ReceiverConfig& cfg, AudioBroadcast& audio_out);
   ~FMReceiver();
 
   bool start();
   void stop();
 
+  // Stations inside the captured span are retuned in DSP at the next block
+  // boundary; others retune the HackRF from the source thread at that
+  // boundary and discard the IQ still in flight. False only out of band;
+  // a device failure shows in wait_control().
   bool set_frequency_mhz(double mhz);
+  // While running, these are handed to the source thread too and take
+  // effect from the next block on, like a DSP retune.
   bool set_lna_gain_db(uint32_t db);
   bool set_vga_gain_db(uint32_t db);
   void set_audio_gain(float g);
+  void set_rds_enabled(bool on);
+
+  // Sequence number of the last control change (set_*) accepted.
+  uint32_t last_control() const;
+  // Waits until audio leaving the pipeline (rds_stage: the RDS decoder)
+  // reflects control change seq, or the device rejected it.
+  ControlResult wait_control(uint32_t seq, bool rds_stage, int timeout_ms) const;
+  // Copy of config() that is safe while set_* run on other threads.
+  ReceiverConfig settings() const;
+  float audio_gain() const;
 
   std::string program_service() const;
+  // Automatic RDS (--rds-auto) transitions and CPU saved.
+  RdsAutoStats rds_auto_stats() const { return rds_.auto_stats(); }
+  const ReceiverConfig& config() const { return cfg_; }
+  std::string source_label() const { return dev_->label(); }
+  // Stereo mode: pilot lock state and level relative to nominal injection.
+  bool stereo_locked() const { return stereo_ && stereo_->pilot_locked(); }
+  float pilot_level() const { return stereo_ ? stereo_->pilot_level() : 0.0f; }
+
+  // Overload governor state and IQ queue overwrite count (transfers).
+  int quality_tier() const { return tier_; }
+  double rtf() const { return rtf_; }
+  uint64_t iq_overruns() const { return q_overruns_; }
+  uint64_t retunes_digital() const { return retunes_digital_; }
+  uint64_t retunes_hw() const { return retunes_hw_; }
+  // Squelch state (always open when disabled) and measured channel power.
+  bool squelch_open() const { return !chan_blk_ || chan_blk_->squelch_open(); }
+  float channel_power_db() const { return chan_blk_ ? chan_blk_->power_db() : 0.0f; }
+  // Process page faults since streaming started (see --prefault / --mlock).
+  long page_faults_streaming() const;
+  uint64_t squelched_blocks() const { return chan_blk_ ? chan_blk_->gated_chunks() : 0; }
+  // Spectrum taps (nullptr when off).
+  const SpectrumMonitor* spectrum_iq() const { return spec_iq_.get(); }
+  const SpectrumMonitor* spectrum_ch() const { return spec_ch_.get(); }
 
 private:
   void on_hackrf_iq(const uint8_t* iq, size_t bytes);
-  void worker();
+  // Source (IQ queue) -> channel -> demod -> {RDS, audio -> audio_out_}
+  void build_graph();
+  // MPX capture, RDS archive and spectrum taps per cfg_; all or none.
+  bool open_outputs();
+  void close_outputs();
+  bool fill_iq(Chunk<SplitIQBuffer>& c);
+  size_t bytes_per_chunk() const;
+  void warm_up(size_t n_iq);
+  // Largest |station - LO| that keeps the channel inside the captured span.
+  double max_digital_offset() const;
+  // Source thread, tune_m_ held: moves the LO to hw_lo_hz_.
+  void apply_hw_tune();
 
   ReceiverConfig cfg_;
-  AudioRingBuffer& audio_out_;
+  AudioBroadcast& audio_out_;
 
-  HackRFDevice dev_;
+  std::unique_ptr<IQSource> dev_;   // see ReceiverConfig::device
 
   ChannelFilter chan_;
   FMDemodulator demod_;
   AudioResampler audio_;
+  std::unique_ptr<StereoDecoder> stereo_;
   RDSDecoder rds_;
 
+  // Retune and control handoff to the worker, applied at a block boundary
+  mutable std::mutex tune_m_;
+  double lo_hz_ = 0.0;
+  bool tune_pending_ = false;
+  double tune_offset_ = 0.0;
+  uint64_t tune_discard_until_ = 0;   // IQ byte sequence; blocks ending at or before it are stale
+  uint32_t ctl_seq_ = 0;              // control changes accepted
+  uint32_t tune_seq_ = 0;             // ctl_seq_ of the pending retune
+  bool hw_pending_ = false;           // LO move for the source thread
+  double hw_lo_hz_ = 0.0;
+  int pending_lna_ = -1;              // hardware gains for the source thread, -1: none
+  int pending_vga_ = -1;
+  uint32_t lna_seq_ = 0, vga_seq_ = 0;
+  std::atomic<uint32_t> ctl_failed_{0};   // last control change the device rejected
+  float audio_gain_ = DEFAULT_AUDIO_GAIN;
+  bool rds_on_ = true;
+  std::atomic<uint64_t> retunes_digital_{0};
+  std::atomic<uint64_t> retunes_hw_{0};
+
+  Squelch sq_;
+  MpxWriter mpx_;                   // optional MPX capture (cfg_.mpx_path)
+  RdsArchiveWriter archive_;        // optional, written from the RDS block thread
+  std::unique_ptr<SpectrumMonitor> spec_iq_;   // optional spectrum taps
+  std::unique_ptr<SpectrumMonitor> spec_ch_;
+
+  std::unique_ptr<FlowGraph> graph_;
+  SourceBlock<SplitIQBuffer>* src_ = nullptr;
+  ChannelFilterBlock* chan_blk_ = nullptr;
+  RDSBlock* rds_blk_ = nullptr;
+  AudioRingSinkBlock* sink_blk_ = nullptr;
+  MpxTapBlock* mpx_tap_ = nullptr;
+  // source thread state
+  uint8_t* raw_ = nullptr;          // in arena_
+  size_t raw_cap_ = 0;
+  double block_s_ = 0.0;
+  uint32_t epoch_ = 0;
+  double cur_offset_ = 0.0;
+  uint64_t seen_overruns_ = 0;
+  std::vector<uint64_t> last_busy_;
+
+  OverloadGovernor gov_;
+  std::atomic<int> tier_{0};
+  std::atomic<double> rtf_{0.0};
+
   std::atomic<bool> running_{false};
-  std::thread th_;
+  bool usb_policy_done_ = false;     // USB callback thread only
+  long faults_at_start_ = 0;
 
-  // IQ queue (byte ring)
+  Arena arena_;
+
+  // IQ queue (byte ring, in arena_)
   std::mutex m_;
   std::condition_variable cv_;
-  std::vector<uint8_t> q_;
+  uint8_t* q_ = nullptr;
+  size_t q_cap_ = 0;
   size_t q_r_ = 0;
   size_t q_w_ = 0;
   size_t q_size_ = 0;
   bool q_stop_ = false;
+  std::atomic<uint64_t> q_overruns_{0};
+
+  // USB callback timestamps: (absolute byte count at end of transfer, t_ns)
+  std::deque<std::pair<uint64_t, uint64_t>> q_marks_;
+  uint64_t q_w_total_ = 0;
+  uint64_t q_r_total_ = 0;
 
-  void q_push(const uint8_t* p, size_t n);
-  size_t q_pop(uint8_t* out, size_t nmax);
+  void q_push(const uint8_t* p, size_t n, uint64_t t_ns);
+  // seq_end: absolute IQ byte count at the end of the popped block
+  size_t q_pop(uint8_t* out, size_t nmax, uint64_t& t_ns, uint64_t& seq_end);
 };
@@ -4,31 +4,47 @@
 #include <mutex>
 #include <vector>
 #include <atomic>
+#include <string>
 #include <hackrf.h>
+#include "IQSource.h"
 
-class HackRFDevice {
+class HackRFDevice : public IQSource {
 public:
-  using RxCallback = std::function<void(const uint8_t* iq_u8, size_t bytes)>;
+  // Empty serial opens the first device found.
+  explicit HackRFDevice(std::string serial = std::string()) : serial_(std::move(serial)) {}
+  ~HackRFDevice() override;
 
-  HackRFDevice() = default;
-  ~HackRFDevice();
+  bool open() override;
+  void close() override;
 
-  bool open();
-  void close();
+  bool configure(double freq_hz, double sample_rate_hz, uint32_t lna_gain_db, uint32_t vga_gain_db) override;
+  bool start_rx(RxCallback cb) override;
+  void stop_rx() override;
 
-  bool configure(double freq_hz, double sample_rate_hz, uint32_t lna_gain_db, uint32_t vga_gain_db);
-  bool start_rx(RxCallback cb);
-  void stop_rx();
+  bool set_frequency(double freq_hz) override;
+  bool set_lna_gain(uint32_t db) override;
+  bool set_vga_gain(uint32_t db) override;
 
-  bool set_frequency(double freq_hz);
-  bool set_lna_gain(uint32_t db);
-  bool set_vga_gain(uint32_t db);
+  // Analog baseband filter bandwidth applied by configure().
+  uint32_t baseband_bw_hz() const override { return bb_bw_hz_; }
+  void set_baseband_bw_hz(uint32_t hz) override { bb_bw_hz_ = hackrf_compute_baseband_filter_bw(hz); }
+  std::string label() const override { return serial_.empty() ? "hackrf" : "hackrf:" + serial_; }
+
+  // Serial numbers of the attached devices.
+  static std::vector<std::string> list_serials();
 
 private:
+  // libhackrf is process-wide: the first user initializes it, the last exits.
+  static bool lib_acquire();
+  static void lib_release();
+
   static int rx_callback_static(hackrf_transfer* transfer);
   int rx_callback(hackrf_transfer* transfer);
 
+  std::string serial_;
   hackrf_device* dev_ = nullptr;
+  bool lib_held_ = false;
   std::atomic<bool> running_{false};
   RxCallback cb_;
+  uint32_t bb_bw_hz_ = 1750000;
 };
@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include "Config.h"
+
+// libhackrf moves IQ in fixed 256 KB USB transfers (no API changes the
+// size) and hands one over only once it is full: 13.65 ms at 9.6 MS/s,
+// 26 ms at 5 MS/s. That is a floor under capture-to-output latency for any
+// block size; --low-latency only shrinks what the pipeline adds after the
+// callback, which is what LatencyStats measures. The stand-in sources use
+// the same size.
+static constexpr size_t USB_TRANSFER_BYTES = 262144;
+
+// Where a receiver's IQ comes from: a HackRF, or a file or synthetic signal
+// standing in for one. Samples are signed 8-bit interleaved I/Q delivered
+// from the source's own thread, as libhackrf does.
+class IQSource {
+public:
+  using RxCallback = std::function<void(const uint8_t* iq, size_t bytes)>;
+
+  virtual ~IQSource() = default;
+
+  virtual bool open() = 0;
+  virtual void close() = 0;
+
+  virtual bool configure(double freq_hz, double sample_rate_hz, uint32_t lna_gain_db, uint32_t vga_gain_db) = 0;
+  virtual bool start_rx(RxCallback cb) = 0;
+  virtual void stop_rx() = 0;
+
+  virtual bool set_frequency(double freq_hz) = 0;
+  virtual bool set_lna_gain(uint32_t) { return true; }
+  virtual bool set_vga_gain(uint32_t) { return true; }
+
+  // Usable analog bandwidth around the LO.
+  virtual uint32_t baseband_bw_hz() const = 0;
+  // Analog filter for the next configure(), rounded to one the device has;
+  // the stand-in sources have none.
+  virtual void set_baseband_bw_hz(uint32_t) {}
+  // For logs: "hackrf", "hackrf:<serial>", "file:<path>", "synth:<MHz>".
+  virtual std::string label() const = 0;
+};
+
+// spec: "" (first HackRF), a HackRF serial number, "file:<path>" or
+// "synth[:<MHz>]"; the synthetic station defaults to cfg.rf_freq_hz.
+std::unique_ptr<IQSource> make_iq_source(const std::string& spec, const ReceiverConfig& cfg);
+
+// Base for sources that generate transfers on a thread paced at the
+// configured sample rate, in HackRF-sized (256 KB) transfers.
+class PacedIQSource : public IQSource {
+public:
+  ~PacedIQSource() override;
+
+  bool configure(double freq_hz, double sample_rate_hz, uint32_t lna_gain_db, uint32_t vga_gain_db) override;
+  bool start_rx(RxCallback cb) override;
+  void stop_rx() override;
+  bool set_frequency(double freq_hz) override { lo_hz_ = freq_hz; return true; }
+  uint32_t baseband_bw_hz() const override { return uint32_t(fs_); }
+
+protected:
+  // Fills one transfer; false ends the stream.
+  virtual bool fill(uint8_t* buf, size_t bytes) = 0;
+
+  double fs_ = 0.0;
+  std::atomic<double> lo_hz_{0.0};
+
+private:
+  void run();
+
+  std::thread th_;
+  std::atomic<bool> running_{false};
+  RxCallback cb_;
+};
+
+// Replays a raw capture (hackrf_transfer -r format), looping at the end.
+// The file's sample rate must match the receiver's.
+class FileIQSource : public PacedIQSource {
+public:
+  explicit FileIQSource(std::string path) : path_(std::move(path)) {}
+  ~FileIQSource() override;
+
+  bool open() override;
+  void close() override;
+  std::string label() const override { return "file:" + path_; }
+
+protected:
+  bool fill(uint8_t* buf, size_t bytes) override;
+
+private:
+  std::string path_;
+  std::FILE* f_ = nullptr;
+};
+
+// One FM carrier modulated by a 1 kHz tone plus a little noise, placed at
+// station_hz relative to whatever the receiver tunes. Direct digital
+// synthesis from a sine table, so it keeps up at 20 MS/s.
+class SyntheticIQSource : public PacedIQSource {
+public:
+  explicit SyntheticIQSource(double station_hz);
+
+  bool open() override { return true; }
+  void close() override { stop_rx(); }
+  std::string label() const override;
+
+protected:
+  bool fill(uint8_t* buf, size_t bytes) override;
+
+private:
+  double station_hz_;
+  float sin_[1024];
+  uint32_t carrier_ph_ = 0;
+  uint32_t tone_ph_ = 0;
+  uint32_t noise_ = 1;
+};
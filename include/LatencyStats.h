@@ -0,0 +1,59 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Monotonic timestamp used to tag blocks at the USB callback.
+inline uint64_t mono_ns() {
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Fixed-bucket latency histogram (10 us resolution up to 100 ms).
+class LatencyStats {
+public:
+  LatencyStats() : hist_(kBuckets + 1, 0) {}
+
+  void record(uint64_t t_capture_ns, uint64_t t_out_ns) {
+    if (t_capture_ns == 0 || t_out_ns < t_capture_ns) return;
+    uint64_t b = (t_out_ns - t_capture_ns) / kBucketNs;
+    if (b > kBuckets) b = kBuckets;
+    std::lock_guard<std::mutex> lock(m_);
+    hist_[b]++;
+    count_++;
+  }
+
+  // Returns the latency in milliseconds at quantile q (0..1), or -1 if empty.
+  double percentile_ms(double q) const {
+    std::lock_guard<std::mutex> lock(m_);
+    if (count_ == 0) return -1.0;
+    uint64_t target = uint64_t(q * double(count_ - 1)) + 1;
+    uint64_t acc = 0;
+    for (size_t i = 0; i < hist_.size(); ++i) {
+      acc += hist_[i];
+      if (acc >= target) return double((i + 1) * kBucketNs) / 1e6;
+    }
+    return double(kBuckets * kBucketNs) / 1e6;
+  }
+
+  uint64_t count() const {
+    std::lock_guard<std::mutex> lock(m_);
+    return count_;
+  }
+
+  void reset() {
+    std::lock_guard<std::mutex> lock(m_);
+    std::fill(hist_.begin(), hist_.end(), 0);
+    count_ = 0;
+  }
+
+private:
+  static constexpr uint64_t kBucketNs = 10000;
+  static constexpr size_t kBuckets = 10000;
+
+  mutable std::mutex m_;
+  std::vector<uint64_t> hist_;
+  uint64_t count_ = 0;
+};
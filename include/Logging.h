@@ -1,23 +1,33 @@
 #pragma once
-#include <cstdio>
-#include <cstdarg>
-#include <mutex>
+#include <cstdint>
 
 enum class LogLevel { Info, Warn, Error, Debug };
 
-inline void log_msg(LogLevel lvl, const char* fmt, ...) {
-  static std::mutex m;
-  std::lock_guard<std::mutex> lock(m);
+// Messages below this level are compiled out (0 Debug, 1 Info, 2 Warn,
+// 3 Error). CMake sets 0 for Debug builds and 1 otherwise.
+#ifndef FM_LOG_MIN_LEVEL
+#define FM_LOG_MIN_LEVEL 1
+#endif
 
-  const char* p = "INFO";
-  if (lvl == LogLevel::Warn) p = "WARN";
-  if (lvl == LogLevel::Error) p = "ERR ";
-  if (lvl == LogLevel::Debug) p = "DBG ";
-
-  std::fprintf(stderr, "[%s] ", p);
-  va_list args;
-  va_start(args, fmt);
-  std::vfprintf(stderr, fmt, args);
-  va_end(args);
-  std::fprintf(stderr, "\n");
+constexpr int log_severity(LogLevel lvl) {
+  return lvl == LogLevel::Debug ? 0 : lvl == LogLevel::Info ? 1 : lvl == LogLevel::Warn ? 2 : 3;
 }
+
+constexpr bool log_compiled(LogLevel lvl) { return log_severity(lvl) >= FM_LOG_MIN_LEVEL; }
+
+// Formats into the calling thread's lock-free ring and returns; a background
+// thread writes to stderr. Never blocks: if the ring is full the message is
+// dropped and counted.
+void log_write(LogLevel lvl, const char* fmt, ...)
+#if defined(__GNUC__)
+  __attribute__((format(printf, 2, 3)))
+#endif
+  ;
+
+// A macro so that filtered calls do not even evaluate their arguments.
+#define log_msg(lvl, ...) \
+  do { if (log_compiled(lvl)) log_write((lvl), __VA_ARGS__); } while (0)
+
+// Writes out everything queued so far (e.g. before exit).
+void log_flush();
+uint64_t log_dropped();
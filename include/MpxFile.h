@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Demodulated MPX capture: discriminator output (radians per sample) at the
+// MPX rate, ~50x smaller than the IQ it came from, for rerunning RDS and
+// audio offline. Little-endian throughout.
+//
+//   header (64 bytes)
+//     "FMMPX\0\0\0", u32 version, u32 format (0 = int16, 1 = float16),
+//     f64 fs_hz, f64 rf_freq_hz, f32 scale (int16: value = sample * scale),
+//     u32 chunk_samples, u64 start_unix_ns, u64 total_samples,
+//     u64 index_offset (0 if the file was not closed cleanly)
+//   chunks
+//     "MPXC", u32 n, u64 first_sample, u64 t_ns, u32 epoch, u32 flags,
+//     then n samples; gated (squelched) chunks carry no payload
+//   index
+//     "MPXI", u32 count, count x (u64 first_sample, u64 chunk_offset)
+//
+// A new epoch means the receiver restarted its chain (retune, squelch
+// opening); replay should reset the downstream stages there too.
+
+enum class MpxFormat : uint32_t { Int16 = 0, Float16 = 1 };
+
+struct MpxInfo {
+  MpxFormat format = MpxFormat::Int16;
+  double fs_hz = 0.0;
+  double rf_freq_hz = 0.0;
+  uint32_t chunk_samples = 0;
+  uint64_t start_unix_ns = 0;
+  uint64_t total_samples = 0;
+};
+
+struct MpxChunkInfo {
+  uint64_t first_sample = 0;
+  uint64_t t_ns = 0;       // capture time of the chunk's last sample (LatencyStats.h)
+  uint32_t epoch = 0;
+  bool gated = false;
+};
+
+class MpxWriter {
+public:
+  MpxWriter() = default;
+  ~MpxWriter();
+
+  bool open(const std::string& path, double fs_hz, double rf_freq_hz, MpxFormat fmt,
+            uint32_t chunk_samples = 8192);
+  // Appends n samples (x may be null when gated). A change of epoch or
+  // gating starts a new chunk.
+  void write(const float* x, size_t n, uint64_t t_ns, uint32_t epoch, bool gated);
+  // Flushes, writes the seek index and finalizes the header.
+  void close();
+
+  bool is_open() const { return f_ != nullptr; }
+  uint64_t samples() const { return total_; }
+
+private:
+  void flush_chunk();
+
+  std::FILE* f_ = nullptr;
+  MpxFormat fmt_ = MpxFormat::Int16;
+  uint32_t chunk_samples_ = 8192;
+  uint64_t total_ = 0;
+  std::vector<float> pend_;
+  uint64_t pend_n_ = 0;           // pending samples (pend_ stays empty when gated)
+  MpxChunkInfo pend_info_;
+  std::vector<uint8_t> enc_;
+  std::vector<std::pair<uint64_t, uint64_t>> index_;
+};
+
+class MpxReader {
+public:
+  MpxReader() = default;
+  ~MpxReader();
+
+  // Uses the stored index, or rebuilds it by scanning the chunks.
+  bool open(const std::string& path);
+  void close();
+
+  const MpxInfo& info() const { return info_; }
+  size_t chunks() const { return index_.size(); }
+
+  // Up to max samples from the current chunk (never spanning two, so ci
+  // describes all of them). 0 at end of file.
+  size_t read(float* out, size_t max, MpxChunkInfo* ci = nullptr);
+  // Positions at an absolute sample via the index.
+  bool seek(uint64_t sample);
+
+private:
+  bool load_chunk(size_t k);
+  bool scan_chunks();
+
+  std::FILE* f_ = nullptr;
+  MpxInfo info_;
+  float scale_ = 1.0f;
+  std::vector<std::pair<uint64_t, uint64_t>> index_;
+  size_t next_ = 0;               // next chunk to load
+  std::vector<float> cur_;
+  size_t cur_pos_ = 0;
+  MpxChunkInfo cur_info_;
+  std::vector<uint8_t> raw_;
+};
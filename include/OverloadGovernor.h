@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Steps the worker through quality tiers from its measured real-time factor
+// (processing time / block duration) so that overload costs quality instead
+// of overwritten IQ. Tiers are cumulative:
+//   0 full quality, 1 RDS off, 2 short channel/audio filters (stereo falls
+//   back to mono), 3 fast discriminator
+class OverloadGovernor {
+public:
+  static constexpr int MAX_TIER = 3;
+
+  OverloadGovernor() = default;
+
+  // Feed one block: its processing time and the signal time it covered, plus
+  // whether the IQ queue overwrote data since the last call. Returns true
+  // when the tier changed.
+  bool update(double proc_s, double block_s, bool overrun);
+
+  int tier() const { return tier_; }
+  double rtf() const { return rtf_; }
+
+  static const char* tier_name(int tier);
+
+private:
+  int tier_ = 0;
+  double rtf_ = 0.0;
+  double hot_s_ = 0.0;    // time spent above the step-down threshold
+  double cool_s_ = 0.0;   // time spent below the step-up threshold
+  double since_change_s_ = 0.0;
+};
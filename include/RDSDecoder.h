@@ -5,8 +5,23 @@
 #include <vector>
 #include <array>
 #include <complex>
+#include <functional>
+#include <mutex>
 #include "dsp/FIRDecimator.h"
 #include "dsp/NCO.h"
+#include "RdsGroup.h"
+#include "RdsDetector.h"
+
+// Automatic mode (RDSDecoder::set_auto) state and counters.
+struct RdsAutoStats {
+  bool engaged = false;
+  uint64_t engages = 0;
+  uint64_t disengages = 0;
+  double idle_s = 0.0;        // signal time the decoding chain was skipped
+  double saved_cpu_s = 0.0;   // what it would have cost, less the probes
+  float snr_db = 0.0f;        // last probe: sidebands over the floor
+  float pilot_db = 0.0f;      // last probe: sidebands relative to the pilot
+};
 
 class RDSDecoder {
 public:
@@ -16,11 +31,24 @@ public:
   void process(const float* mpx, size_t n);
 
   std::string program_service() const;
+  // PI code from block A of the last complete group, 0 if none yet.
+  uint16_t program_id() const;
   void set_enabled(bool en);
+  // Automatic mode: the decoding chain runs only once RdsDetector finds a
+  // subcarrier, and stops again after sync_loss_s without a clean group.
+  // Off by default. Call before processing.
+  void set_auto(bool on, double sync_loss_s = 5.0);
+  RdsAutoStats auto_stats() const;
+  // Called on the decoding thread for every group, with per-block error
+  // flags; groups with all four blocks failed are not reported.
+  void set_group_callback(std::function<void(const RdsGroup&)> cb) { on_group_ = std::move(cb); }
 
 private:
+  void reset_chain();
+  // Automatic mode with the chain off: probe only.
+  void idle(const float* mpx, size_t n);
   void push_bit(int bit);
-  void handle_group(uint16_t A, uint16_t B, uint16_t C, uint16_t D);
+  void handle_group(uint16_t A, uint16_t B, uint16_t C, uint16_t D, uint8_t errs);
 
   double fs_ = 0;
   bool enabled_ = true;
@@ -29,8 +57,8 @@ private:
   FIRDecimatorR lp_;
   NCO nco_;
 
-  std::vector<float> tmp1_;
-  std::vector<float> tmp2_;
+  AlignedFloats tmp1_;
+  AlignedFloats tmp2_;
   std::vector<std::complex<float>> tmpc_;
 
   double chip_phase_ = 0.0;
@@ -44,11 +72,28 @@ private:
   bool have_sync_ = false;
   uint16_t blocks_[4] = {0,0,0,0};
   uint8_t block_idx_ = 0;
+  uint8_t block_errs_ = 0;
+  std::function<void(const RdsGroup&)> on_group_;
 
   uint32_t shift_ = 0;
   uint8_t bits_in_shift_ = 0;
 
   std::array<char, 9> ps_{};
   std::array<char, 9> last_ps_{};
+  mutable std::mutex ps_m_;
   std::string station_ps_;
+  uint16_t station_pi_ = 0;
+
+  // automatic mode, decoding thread only
+  RdsDetector det_;
+  bool auto_ = false;
+  bool engaged_ = false;
+  size_t sync_loss_ = 0;          // samples without a clean group before stopping
+  size_t since_good_ = 0;
+  bool good_seen_ = false;        // a clean group since engaging
+  double backoff_s_ = 0.0;        // probe hold-off after a fruitless engagement
+  double chain_ns_ = 0.0;         // decoding chain cost per sample
+  uint32_t chain_runs_ = 0;
+  mutable std::mutex stats_m_;
+  RdsAutoStats stats_;
 };
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "RdsGroup.h"
+
+struct RdsRecord {
+  uint64_t t_us = 0;      // wall clock, microseconds since the Unix epoch
+  RdsGroup group;
+};
+
+// Append-only archive of RDS groups, one directory per station:
+//
+//   <root>/<PI hex>/<first group time, us>.rds
+//
+// Each segment file is memory-mapped at a fixed capacity and holds:
+//   header (4 KB)    magic, version, PI, RF frequency, capacity, count,
+//                    first/last time, index stride
+//   sparse index     time of every INDEX_STRIDE-th record
+//   records          16 bytes each: u64 time_us | errors << 60, u16 A-D
+// A query picks segments by their first/last time, binary-searches the
+// sparse index and scans at most one stride before the range starts.
+// The count is published after the record, so a reader may map a segment
+// that is still being written.
+class RdsArchiveWriter {
+public:
+  RdsArchiveWriter() = default;
+  ~RdsArchiveWriter();
+  RdsArchiveWriter(const RdsArchiveWriter&) = delete;
+  RdsArchiveWriter& operator=(const RdsArchiveWriter&) = delete;
+
+  bool open(const std::string& root);
+  // Rotates to a new segment when the PI changes or the segment is full.
+  // Groups whose block A failed go to the current station.
+  void append(const RdsGroup& g, uint64_t t_us, double rf_freq_hz);
+  void close();
+
+  bool is_open() const { return !root_.empty(); }
+  uint64_t records() const { return total_; }
+
+private:
+  bool start_segment(uint16_t pi, uint64_t t_us, double rf_freq_hz);
+  void finish_segment();
+
+  std::string root_;
+  int fd_ = -1;
+  uint8_t* map_ = nullptr;
+  size_t map_len_ = 0;
+  uint16_t pi_ = 0;
+  uint64_t count_ = 0;
+  uint64_t total_ = 0;
+};
+
+class RdsArchiveReader {
+public:
+  explicit RdsArchiveReader(std::string root) : root_(std::move(root)) {}
+
+  // Calls fn for every record of station pi with t1_us <= t < t2_us, in
+  // time order; fn returns false to stop. False if the station is unknown.
+  bool query(uint16_t pi, uint64_t t1_us, uint64_t t2_us,
+             const std::function<bool(const RdsRecord&)>& fn) const;
+
+  // Stations (PI codes) present in the archive.
+  std::vector<uint16_t> stations() const;
+
+private:
+  std::string root_;
+};
+
+// Current wall clock for RdsRecord::t_us.
+uint64_t rds_now_us();
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Cheap test for an RDS subcarrier in the MPX, so the full decoder can stay
+// off on stations that carry none. Every period_s one short window (about
+// 20 ms) goes through Goertzel probes: bins on both 57 kHz sidebands, where
+// biphase RDS puts its energy (the carrier itself is suppressed), bins on
+// the empty band just above as the noise floor, and the 19 kHz pilot as a
+// level reference. Present opens when both sidebands stand 6 dB over the
+// floor and closes below 3 dB, on levels smoothed over successive probes.
+class RdsDetector {
+public:
+  explicit RdsDetector(double fs_mpx, double period_s = 0.5);
+
+  // Returns true when a probe finished within this block.
+  bool process(const float* mpx, size_t n);
+  // Forget the smoothed levels and probe from the next sample on.
+  void reset();
+  // Skip the next s seconds of signal before probing again.
+  void hold_off(double s);
+
+  bool present() const { return present_; }
+  // Smoothed level of the weaker sideband over the floor, and of both
+  // relative to the pilot bin.
+  float snr_db() const;
+  float pilot_db() const;
+  // Share of the samples that go through the probes.
+  double duty() const { return double(window_) / double(window_ + gap_); }
+
+private:
+  struct Bin {
+    float coef = 0.0f;
+    float s1 = 0.0f, s2 = 0.0f;
+  };
+  static float power(const Bin& b) { return b.s1 * b.s1 + b.s2 * b.s2 - b.coef * b.s1 * b.s2; }
+  static float trimmed_power(Bin* b);
+  void finish();
+
+  double fs_;
+  size_t window_ = 0;              // samples per probe
+  size_t gap_ = 0;                 // samples between probes
+  std::vector<Bin> side_, floor_;
+  Bin pilot_;
+  std::vector<float> win_, buf_;
+
+  size_t fill_ = 0;                // samples in the current probe
+  size_t skip_ = 0;                // samples left before it starts
+  bool primed_ = false;
+  bool present_ = false;
+  float lo_p_ = 0.0f, hi_p_ = 0.0f;  // smoothed power per bin: lower, upper sideband
+  float floor_p_ = 0.0f, pilot_p_ = 0.0f;
+};
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+// One decoded RDS group as received: raw blocks A-D and, per block, whether
+// its syndrome failed (bit k = block k).
+struct RdsGroup {
+  uint16_t blocks[4] = {0, 0, 0, 0};
+  uint8_t errors = 0;
+
+  uint16_t pi() const { return blocks[0]; }
+  uint8_t type() const { return uint8_t(blocks[1] >> 12); }
+  bool version_b() const { return (blocks[1] >> 11) & 1; }
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Scheduling for one thread: pin to a CPU and optionally run SCHED_FIFO.
+struct ThreadPolicy {
+  int cpu = -1;        // -1 leaves affinity alone
+  int fifo_prio = 0;   // 1..99 for SCHED_FIFO, 0 keeps the normal scheduler
+
+  bool empty() const { return cpu < 0 && fifo_prio <= 0; }
+};
+
+// Applies the policy to the calling thread and logs, per setting, whether it
+// was applied or denied (and why). Returns true if everything requested took.
+// Also pre-faults a slice of the thread's stack.
+bool apply_thread_policy(const std::string& name, const ThreadPolicy& p);
+
+// mlockall(MCL_CURRENT | MCL_FUTURE), reported like apply_thread_policy.
+bool lock_memory();
+
+// Touches every page of [p, p + bytes) so later accesses do not fault.
+void prefault(void* p, size_t bytes);
+
+// Minor + major page faults of this process so far.
+long page_faults();
+
+// "2,3" -> {2, 3}. False, leaving out alone, unless s is a comma-separated
+// list of CPU numbers below CPU_SETSIZE.
+bool parse_cpu_list(const char* s, std::vector<int>& out);
+// One CPU number, as in parse_cpu_list.
+bool parse_cpu(const char* s, int& cpu);
@@ -0,0 +1,59 @@
+#pragma once
+#include "Config.h"
+#include "AudioBroadcast.h"
+#include "FMReceiver.h"
+#include "WavWriter.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Totals across every receiver of a ReceiverSet.
+struct ReceiverSetStats {
+  size_t receivers = 0;
+  int worst_tier = 0;
+  double worst_rtf = 0.0;
+  uint64_t iq_overruns = 0;
+  uint64_t squelched_blocks = 0;
+  uint64_t audio_samples = 0;
+};
+
+// Several independent receivers in one process, one per IQ source (e.g. one
+// per HackRF, selected by serial). Each has its own pipeline threads, audio
+// ring and WAV writer; nothing is shared but the process.
+class ReceiverSet {
+public:
+  // base: settings common to all receivers; wav_path is the name stem.
+  explicit ReceiverSet(const ReceiverConfig& base);
+  ~ReceiverSet();
+
+  // device: see ReceiverConfig::device. False when its audio ring cannot
+  // be mapped.
+  bool add(const std::string& device, double freq_hz);
+
+  // Starts all or none.
+  bool start();
+  void stop();
+
+  size_t size() const { return units_.size(); }
+  FMReceiver& receiver(size_t i) { return *units_[i]->rx; }
+  const FMReceiver& receiver(size_t i) const { return *units_[i]->rx; }
+  ReceiverSetStats stats() const;
+
+private:
+  struct Unit {
+    ReceiverConfig cfg;
+    std::unique_ptr<AudioBroadcast> audio;
+    AudioReader* wav_in = nullptr;
+    std::unique_ptr<FMReceiver> rx;
+    WavWriter wav;
+    std::thread drain;
+    std::atomic<uint64_t> samples{0};
+  };
+  void drain(Unit& u);
+
+  ReceiverConfig base_;
+  std::vector<std::unique_ptr<Unit>> units_;
+  std::atomic<bool> running_{false};
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include "AudioBroadcast.h"
+#include "LatencyStats.h"
+#include "AdaptiveResampler.h"
+#include "RealTime.h"
+
+// Streams PCM from an AudioReader as RTP/L16 (RFC 3551) over UDP.
+// Every packet goes to all destinations; sends are batched with sendmmsg.
+class RtpSink {
+public:
+  RtpSink(AudioReader& in, uint32_t sample_rate, uint16_t channels);
+  ~RtpSink();
+
+  // dests: "host:port" entries, unicast or IPv4 multicast.
+  bool open(const std::vector<std::string>& dests, double packet_ms,
+            uint8_t payload_type = 96, int multicast_ttl = 1);
+  // Paced mode sends on the local clock instead of as data arrives, with an
+  // AdaptiveResampler holding target_fill_ms buffered. Call before start().
+  void set_paced(double target_fill_ms);
+  // Applied by the sender thread when it starts. Call before start().
+  void set_thread_policy(const ThreadPolicy& p) { policy_ = p; }
+  bool start();
+  // Stops the input reader so a pending pop returns, then joins.
+  void stop();
+  void close();
+
+  uint64_t packets_sent() const { return packets_sent_; }
+  uint64_t send_errors() const { return send_errors_; }
+  // Capture-to-send latency of each packet batch.
+  const LatencyStats& latency() const { return latency_; }
+  // Paced mode only: estimated receiver/sink clock offset.
+  double drift_ppm() const { return adapt_ ? adapt_->drift_ppm() : 0.0; }
+  double fill_ms() const { return adapt_ ? adapt_->fill_ms() : 0.0; }
+
+private:
+  void worker();
+  void worker_paced();
+  void build_packet(const int16_t* pcm, uint8_t* pkt);
+  void flush(size_t n_packets);
+
+  AudioReader& in_;
+  uint32_t sample_rate_ = 48000;
+  uint16_t channels_ = 1;
+
+  int fd_ = -1;
+  std::vector<sockaddr_in> dests_;
+
+  uint8_t pt_ = 96;
+  uint16_t seq_ = 0;
+  uint32_t ts_ = 0;
+  uint32_t ssrc_ = 0;
+  size_t frames_per_packet_ = 240;
+
+  // up to batch_ packets are staged before one sendmmsg call
+  size_t batch_ = 8;
+  std::vector<uint8_t> pkts_;
+
+  std::unique_ptr<AdaptiveResampler> adapt_;
+  ThreadPolicy policy_;
+
+  std::atomic<bool> running_{false};
+  std::thread th_;
+
+  std::atomic<uint64_t> packets_sent_{0};
+  std::atomic<uint64_t> send_errors_{0};
+  LatencyStats latency_;
+};
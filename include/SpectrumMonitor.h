@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "dsp/FFT.h"
+#include "dsp/SplitIQ.h"
+
+// Averaged power spectra of an IQ stream for watching a band or a channel
+// without recording IQ. Only a strided subset of the samples is transformed:
+// each frame averages `avg` windowed FFTs spread evenly over 1 / rate_hz.
+// If the analysis itself costs more than budget of the wall time, fewer
+// FFTs go into each frame, then (at one) fewer frames, until it fits again.
+//
+// Frames go to a file (appended one after another) or, for a "udp:host:port"
+// destination, one frame per datagram. Each frame is self-describing and
+// little-endian:
+//   "FMSP", u16 version, u16 bins, u8 source (0 = wideband IQ, 1 = channel),
+//   u8 reserved, u16 ffts averaged, u32 sequence, f64 fs_hz, f64 center_hz,
+//   u64 capture time (Unix ns), f32 db_min, f32 db_step,
+//   then bins x u8 power, DC in the middle: dBFS = db_min + value * db_step.
+// As rows of 8-bit pixels, a run of frames is a waterfall image as-is.
+struct SpectrumSettings {
+  size_t fft_n = 1024;       // power of two
+  double rate_hz = 5.0;      // frames per second
+  int avg = 8;               // FFTs per frame
+  double budget = 0.03;      // fraction of one core
+};
+
+enum class SpectrumSource : uint8_t { Wideband = 0, Channel = 1 };
+
+class SpectrumMonitor {
+public:
+  SpectrumMonitor(SpectrumSource src, double fs_hz, const SpectrumSettings& s);
+  ~SpectrumMonitor();
+
+  // dest: file path or "udp:<IPv4>:<port>".
+  bool open(const std::string& dest);
+  void close();
+  bool is_open() const { return f_ != nullptr || fd_ >= 0; }
+
+  // Starts the next frame over (after a retune).
+  void reset();
+  // t_ns: capture time of the last sample (LatencyStats.h).
+  void process(ConstSplitIQView x, uint64_t t_ns, double center_hz);
+
+  uint64_t frames() const { return seq_; }
+  // Current averaging; below the configured value when over budget.
+  int ffts_per_frame() const { return avg_now_; }
+  SpectrumSource source() const { return src_; }
+
+private:
+  void emit(uint64_t t_ns, double center_hz);
+  void set_level(int level);
+
+  SpectrumSource src_;
+  double fs_;
+  SpectrumSettings s_;
+  FFT fft_;
+  std::vector<float> win_;
+  float norm_ = 1.0f;            // full-scale tone -> 0 dBFS
+
+  std::vector<std::complex<float>> buf_;
+  std::vector<float> acc_;
+  size_t fill_ = 0;              // samples collected for the current FFT
+  size_t skip_ = 0;              // samples to pass over before the next one
+  size_t hop_ = 0;               // FFT start to FFT start, samples
+  int count_ = 0;                // FFTs in acc_
+  int level_ = 0;                // budget step-downs in effect
+  std::atomic<int> avg_now_{0};
+  double frame_s_ = 0.0;         // signal time per frame at this level
+
+  uint64_t busy_ns_ = 0;         // analysis time since the last frame
+  uint64_t last_frame_ns_ = 0;
+  std::atomic<uint32_t> seq_{0};
+  std::vector<uint8_t> frame_;
+
+  std::FILE* f_ = nullptr;
+  int fd_ = -1;
+};
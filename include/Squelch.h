@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include "dsp/SplitIQ.h"
+
+// Carrier squelch on the channel filter output. Two cheap per-block
+// measurements: channel power, and envelope flatness E|x|^4 / (E|x|^2)^2,
+// which is 1 for a constant-envelope FM carrier and 2 for Gaussian noise
+// (so it needs no calibration against receiver gain). Opens when both pass,
+// closes with hysteresis on both and after a hang time.
+class Squelch {
+public:
+  // open_db: channel power (dBFS) needed to open; closes hyst_db below it.
+  Squelch(float open_db, float hyst_db, double hang_s);
+
+  // Measure one block covering block_s of signal. Returns true when the
+  // state changed.
+  bool update(ConstSplitIQView x, double block_s);
+  void reset();
+  // New channel, same state: the next block re-primes the measurements and
+  // the usual hysteresis and hang time decide whether to close.
+  void remeasure();
+
+  bool is_open() const { return open_; }
+  float power_db() const { return power_db_; }
+  float flatness() const { return flat_; }
+
+private:
+  float open_db_ = -60.0f;
+  float close_db_ = -63.0f;
+  double hang_s_ = 0.3;
+
+  bool open_ = false;
+  bool primed_ = false;
+  float power_db_ = -200.0f;
+  float flat_ = 2.0f;
+  double below_s_ = 0.0;   // time the close condition has held
+};
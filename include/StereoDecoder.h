@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include "Config.h"
+#include "dsp/Resampler.h"
+
+// Stereo MPX to interleaved L/R PCM in one fused, chunked pass: 19 kHz pilot
+// PLL, L+R / L-R separation against the doubled pilot, both channels through
+// one shared polyphase bank to fs_out, then matrix and per-channel
+// de-emphasis. Blends to mono while the pilot is weak or unlocked.
+class StereoDecoder {
+public:
+  StereoDecoder(double fs_in, double fs_out, float deemph_tau_s, float audio_cut_hz);
+  void reset();
+
+  // out_lr: interleaved L/R; out_frames_cap in frames. Returns frames written.
+  size_t process(const float* in_mpx, size_t n_in,
+                 int16_t* out_lr, size_t out_frames_cap);
+
+  double fs_out() const;
+  void set_audio_gain(float g);
+
+  bool pilot_locked() const { return locked_; }
+  // Pilot amplitude relative to the nominal 9% injection.
+  float pilot_level() const { return pilot_level_; }
+
+private:
+  size_t mix_chunk(const float* in, size_t n);
+
+  double fs_in_ = 0;
+  double fs_out_ = 0;
+  float scale_ = 1.0f;   // rad/sample -> full scale at 75 kHz deviation
+  float gain_ = DEFAULT_AUDIO_GAIN;
+
+  // pilot PLL: (c_, s_) = cos/sin of the pilot phase estimate
+  float c_ = 1.0f, s_ = 0.0f;
+  float cb_ = 1.0f, sb_ = 0.0f;    // nominal 19 kHz step
+  float freq_ = 0.0f;              // rad/sample offset from nominal
+  float alpha_ = 0.0f, beta_ = 0.0f, max_freq_ = 0.0f;
+  float pi_ = 0.0f, pq_ = 0.0f;    // lowpassed in-phase / quadrature pilot arms
+  float k_amp_ = 0.0f;
+  float nominal_ = 0.0f;           // expected pilot amplitude (rad/sample)
+
+  // rate conversion: shared bank for both channels, plus Farrow when irrational
+  RationalResamplerR2 rs_;
+  bool use_farrow_ = false;
+  FarrowResamplerR far_s_, far_d_;
+
+  // per-channel de-emphasis at fs_out and mono/stereo blend
+  float a_ = 0.0f;
+  float yl_ = 0.0f, yr_ = 0.0f;
+  float blend_ = 0.0f, blend_step_ = 0.0f;
+
+  std::atomic<bool> locked_{false};
+  std::atomic<float> pilot_level_{0.0f};
+
+  AlignedFloats s_buf_, d_buf_;          // chunk at fs_in
+  AlignedFloats s_mid_, d_mid_;          // chunk after polyphase stage
+  AlignedFloats s_out_, d_out_;          // chunk at fs_out
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+// In-place radix-2 complex FFT with precomputed twiddles.
+class FFT {
+public:
+  explicit FFT(size_t n);
+
+  size_t size() const { return n_; }
+  void forward(std::complex<float>* data) const;
+
+private:
+  size_t n_ = 0;
+  std::vector<std::complex<float>> tw_;
+  std::vector<size_t> rev_;
+};
+
+// 4-term Blackman-Harris, ~92 dB sidelobes.
+std::vector<float> blackman_harris(size_t n);
@@ -3,23 +3,56 @@
 #include <complex>
 #include <cstddef>
 #include <cstdint>
+#include "dsp/SplitIQ.h"
 
+// Complex decimating FIR. Works on split I/Q internally: history is kept as
+// linear I and Q arrays so each output is two contiguous dot products.
 class FIRDecimatorC {
 public:
   FIRDecimatorC() = default;
   FIRDecimatorC(const std::vector<float>& taps, uint32_t decim);
 
   void reset();
-  // in: complex float samples
-  // out: writes decimated samples
+  // out.n is the capacity; returns outputs written
+  size_t process(ConstSplitIQView in, SplitIQView out);
+  // Interleaved form, converted through internal scratch.
   size_t process(const std::complex<float>* in, size_t n_in, std::complex<float>* out, size_t out_cap);
 
 private:
-  std::vector<float> taps_;
-  std::vector<std::complex<float>> delay_;
-  size_t di_ = 0;
+  AlignedFloats taps_;           // reversed
+  size_t nt_ = 0;
+  AlignedFloats hi_, hq_;        // last nt_-1 inputs, then the current chunk
+  uint32_t decim_ = 1;
+  uint32_t phase_ = 0;
+  SplitIQBuffer sin_, sout_;
+};
+
+// Same contract as FIRDecimatorC, but the lowpass taps are pre-rotated to a
+// bandpass at offset_hz and the output is counter-rotated at the decimated
+// rate, so the channel is mixed down to DC as part of the filter. When
+// offset_hz is a multiple of fs/decim the counter-rotation is identity.
+// The rotated taps are complex: twice the MACs of FIRDecimatorC per output.
+class FIRDecimatorXlate {
+public:
+  FIRDecimatorXlate() = default;
+  FIRDecimatorXlate(const std::vector<float>& taps, uint32_t decim, double fs, double offset_hz);
+
+  void reset();
+  size_t process(ConstSplitIQView in, SplitIQView out);
+  size_t process(const std::complex<float>* in, size_t n_in, std::complex<float>* out, size_t out_cap);
+
+private:
+  AlignedFloats tr_, ti_;        // rotated taps, reversed
+  size_t nt_ = 0;
+  AlignedFloats hi_, hq_;
   uint32_t decim_ = 1;
   uint32_t phase_ = 0;
+  SplitIQBuffer sin_, sout_;
+
+  // output rotator exp(-j*w*n), stepping by w*decim per output
+  std::complex<double> rot_{1.0, 0.0};
+  std::complex<double> rot_step_{1.0, 0.0};
+  bool rotate_ = false;
 };
 
 class FIRDecimatorR {
@@ -31,8 +64,8 @@ public:
   size_t process(const float* in, size_t n_in, float* out, size_t out_cap);
 
 private:
-  std::vector<float> taps_;
-  std::vector<float> delay_;
+  AlignedFloats taps_;
+  AlignedFloats delay_;
   size_t di_ = 0;
   uint32_t decim_ = 1;
   uint32_t phase_ = 0;
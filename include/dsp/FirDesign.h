@@ -6,12 +6,17 @@ inline std::vector<float> design_lowpass(float fs, float fc, int ntaps) {
   std::vector<float> h(ntaps);
   float norm = fc / fs;
   int M = ntaps - 1;
+  double sum = 0.0;
   for (int n = 0; n < ntaps; ++n) {
     float x = float(n - M / 2.0f);
-    float sinc = (x == 0.0f) ? 1.0f : std::sin(2.0f * float(M_PI) * norm * x) / (float(M_PI) * x);
+    // ideal response 2*norm*sinc(2*norm*x)
+    float ideal = (x == 0.0f) ? 2.0f * norm : std::sin(2.0f * float(M_PI) * norm * x) / (float(M_PI) * x);
     float w = 0.54f - 0.46f * std::cos(2.0f * float(M_PI) * n / M); // Hamming
-    h[n] = 2.0f * norm * sinc * w;
+    h[n] = ideal * w;
+    sum += h[n];
   }
+  // unity DC gain
+  for (auto& v : h) v = float(v / sum);
   return h;
 }
 
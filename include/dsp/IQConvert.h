@@ -0,0 +1,22 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include "dsp/SplitIQ.h"
+
+// HackRF delivers interleaved signed 8-bit I/Q.
+inline void iq_s8_to_cf32(const uint8_t* raw, size_t n_iq, std::complex<float>* out) {
+  const int8_t* s = reinterpret_cast<const int8_t*>(raw);
+  for (size_t i = 0; i < n_iq; ++i) {
+    out[i] = {float(s[2*i]) / 128.0f, float(s[2*i + 1]) / 128.0f};
+  }
+}
+
+// Same, straight into split I/Q arrays.
+inline void iq_s8_to_split(const uint8_t* raw, size_t n_iq, SplitIQView out) {
+  const int8_t* s = reinterpret_cast<const int8_t*>(raw);
+  for (size_t i = 0; i < n_iq; ++i) {
+    out.i[i] = float(s[2*i]) * (1.0f / 128.0f);
+    out.q[i] = float(s[2*i + 1]) * (1.0f / 128.0f);
+  }
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// Memory for DSP buffers and queues: cache-line aligned heap vectors for
+// buffers that resize, and mmap-backed regions (optionally huge pages,
+// optionally NUMA-local) for the large fixed rings of a pipeline.
+
+static constexpr size_t SIMD_ALIGN = 64;
+
+template <class T>
+struct AlignedAllocator {
+  using value_type = T;
+  AlignedAllocator() = default;
+  template <class U> AlignedAllocator(const AlignedAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    size_t bytes = (n * sizeof(T) + SIMD_ALIGN - 1) & ~(SIMD_ALIGN - 1);
+    void* p = std::aligned_alloc(SIMD_ALIGN, bytes ? bytes : SIMD_ALIGN);
+    if (!p) throw std::bad_alloc();
+    return static_cast<T*>(p);
+  }
+  void deallocate(T* p, size_t) { std::free(p); }
+
+  template <class U> bool operator==(const AlignedAllocator<U>&) const { return true; }
+  template <class U> bool operator!=(const AlignedAllocator<U>&) const { return false; }
+};
+
+template <class T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+using AlignedFloats = AlignedVector<float>;
+
+enum class HugePages {
+  Off,          // 4 KB pages
+  Transparent,  // 2 MB aligned, madvise(MADV_HUGEPAGE)
+  Explicit,     // MAP_HUGETLB from the reserved pool, else Transparent
+};
+
+// One anonymous mapping. Move-only; unmapped on destruction.
+class MemRegion {
+public:
+  MemRegion() = default;
+  ~MemRegion() { unmap(); }
+  MemRegion(MemRegion&& o) noexcept;
+  MemRegion& operator=(MemRegion&& o) noexcept;
+  MemRegion(const MemRegion&) = delete;
+  MemRegion& operator=(const MemRegion&) = delete;
+
+  // numa_node >= 0 prefers that node for the pages (first touch otherwise).
+  // Rounds bytes up to the page size in use. Logs what it got.
+  bool map(size_t bytes, HugePages hp = HugePages::Off, int numa_node = -1, const char* what = "region");
+  void unmap();
+
+  void* data() const { return p_; }
+  size_t size() const { return size_; }
+  bool hugetlb() const { return hugetlb_; }
+
+private:
+  void* p_ = nullptr;
+  size_t size_ = 0;
+  void* base_ = nullptr;   // mapping start/length (THP alignment may offset p_)
+  size_t base_len_ = 0;
+  bool hugetlb_ = false;
+};
+
+// Bump allocator over one region: everything a pipeline sizes once at
+// start, 64-byte aligned and freed together.
+class Arena {
+public:
+  Arena() = default;
+  bool reserve(size_t bytes, HugePages hp = HugePages::Off, int numa_node = -1, const char* what = "arena");
+
+  // nullptr when the arena is full.
+  void* alloc(size_t bytes);
+  template <class T>
+  T* alloc_array(size_t n) { return static_cast<T*>(alloc(n * sizeof(T))); }
+
+  size_t used() const { return used_; }
+  size_t capacity() const { return mem_.size(); }
+
+private:
+  MemRegion mem_;
+  size_t used_ = 0;
+};
+
+// NUMA node of a CPU, -1 when unknown or the machine has a single node.
+int numa_node_of_cpu(int cpu);
@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "dsp/Memory.h"
+
+// Best rational approximation num/den of x with den <= max_den.
+// Returns true when it matches x to within 1e-9 relative.
+bool rational_approx(double x, uint32_t max_den, uint32_t& num, uint32_t& den);
+
+// Polyphase L/M resampler (real). The prototype lowpass runs at fs_in * L.
+class RationalResamplerR {
+public:
+  RationalResamplerR() = default;
+  // proto: lowpass designed at fs_in * interp, length multiple of interp (padded otherwise)
+  RationalResamplerR(const std::vector<float>& proto, uint32_t interp, uint32_t decim);
+
+  void reset();
+  size_t process(const float* in, size_t n_in, float* out, size_t out_cap);
+
+private:
+  AlignedFloats bank_;          // interp_ phases x ntaps_, each reversed
+  AlignedFloats hist_;     // doubled history so each dot product is contiguous
+  size_t ntaps_ = 0;
+  size_t hi_ = 0;
+  uint32_t interp_ = 1;
+  uint32_t decim_ = 1;
+  uint32_t phase_ = 0;
+};
+
+// Two channels through the same polyphase bank in one pass (e.g. L+R and
+// L-R of stereo MPX); each tap is loaded once for both channels.
+class RationalResamplerR2 {
+public:
+  RationalResamplerR2() = default;
+  RationalResamplerR2(const std::vector<float>& proto, uint32_t interp, uint32_t decim);
+
+  void reset();
+  size_t process(const float* in_a, const float* in_b, size_t n_in,
+                 float* out_a, float* out_b, size_t out_cap);
+
+private:
+  AlignedFloats bank_;
+  AlignedFloats hist_;          // interleaved a/b pairs, doubled
+  size_t ntaps_ = 0;
+  size_t hi_ = 0;
+  uint32_t interp_ = 1;
+  uint32_t decim_ = 1;
+  uint32_t phase_ = 0;
+};
+
+// Cubic Lagrange resampler in Farrow form for arbitrary (and adjustable)
+// ratios. Input must already be bandlimited well below the output Nyquist.
+class FarrowResamplerR {
+public:
+  FarrowResamplerR() = default;
+  explicit FarrowResamplerR(double ratio_out_over_in);
+
+  void reset();
+  void set_ratio(double ratio_out_over_in);
+  double ratio() const { return 1.0 / step_; }
+
+  size_t process(const float* in, size_t n_in, float* out, size_t out_cap);
+  // Pull form: stops when out_cap is reached and reports how many inputs were
+  // consumed; the rest must be passed again on the next call.
+  size_t process(const float* in, size_t n_in, size_t& consumed, float* out, size_t out_cap);
+
+private:
+  void shift_in(float x);
+
+  double step_ = 1.0;  // input samples per output sample
+  double mu_ = 1.0;    // >= 1 means the next input must be shifted in first
+  float h_[4] = {0, 0, 0, 0};
+  float c_[4] = {0, 0, 0, 0};
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "dsp/Memory.h"
+
+// Split (structure-of-arrays) complex samples: separate I and Q arrays so
+// kernels run straight down each one without deinterleaving shuffles.
+
+// Non-owning views; n is the sample count (or capacity for outputs).
+struct SplitIQView {
+  float* i = nullptr;
+  float* q = nullptr;
+  size_t n = 0;
+};
+
+struct ConstSplitIQView {
+  const float* i = nullptr;
+  const float* q = nullptr;
+  size_t n = 0;
+
+  ConstSplitIQView() = default;
+  ConstSplitIQView(const float* i_, const float* q_, size_t n_) : i(i_), q(q_), n(n_) {}
+  ConstSplitIQView(const SplitIQView& v) : i(v.i), q(v.q), n(v.n) {}
+};
+
+// Owning, 64-byte aligned I and Q arrays.
+class SplitIQBuffer {
+public:
+  SplitIQBuffer() = default;
+  explicit SplitIQBuffer(size_t n) { resize(n); }
+
+  void resize(size_t n) { i_.resize(n); q_.resize(n); }
+  size_t size() const { return i_.size(); }
+
+  float* i() { return i_.data(); }
+  float* q() { return q_.data(); }
+
+  SplitIQView view() { return {i_.data(), q_.data(), i_.size()}; }
+  SplitIQView view(size_t off, size_t n) { return {i_.data() + off, q_.data() + off, n}; }
+  ConstSplitIQView cview(size_t n) const { return {i_.data(), q_.data(), n}; }
+
+private:
+  AlignedFloats i_, q_;
+};
+
+inline void deinterleave(const std::complex<float>* in, size_t n, SplitIQView out) {
+  const float* p = reinterpret_cast<const float*>(in);
+  for (size_t k = 0; k < n; ++k) {
+    out.i[k] = p[2*k];
+    out.q[k] = p[2*k + 1];
+  }
+}
+
+inline void interleave(ConstSplitIQView in, std::complex<float>* out) {
+  float* p = reinterpret_cast<float*>(out);
+  for (size_t k = 0; k < in.n; ++k) {
+    p[2*k] = in.i[k];
+    p[2*k + 1] = in.q[k];
+  }
+}
@@ -0,0 +1,173 @@
+#pragma once
+#include "flow/Graph.h"
+#include "dsp/SplitIQ.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class ChannelFilter;
+class Squelch;
+class FMDemodulator;
+class AudioResampler;
+class StereoDecoder;
+class RDSDecoder;
+class AudioBroadcast;
+class MpxWriter;
+class SpectrumMonitor;
+
+// Receiver stages as flowgraph blocks. Each wraps an existing DSP object
+// (owned by the caller) and reacts to the chunk tag: a new epoch restarts
+// its state, the tier selects its cost, gated chunks skip the work.
+
+// Split IQ at the RF rate -> channel at the MPX rate. Also runs the optional
+// squelch; a squelch opening starts a new epoch downstream.
+class ChannelFilterBlock : public FlowBlock {
+public:
+  ChannelFilterBlock(ChannelFilter& chan, Squelch* sq, double block_s);
+
+  InPort<SplitIQBuffer> in{this};
+  OutPort<SplitIQBuffer> out{this};
+
+  bool work() override;
+
+  bool squelch_open() const { return sq_open_; }
+  float power_db() const { return power_db_; }
+  uint64_t gated_chunks() const { return gated_; }
+  // Samples sent downstream (ChunkTag::sample of the next chunk). Read it
+  // once the graph has finished.
+  uint64_t samples_out() const { return out_samples_; }
+
+private:
+  ChannelFilter& chan_;
+  Squelch* sq_;
+  double block_s_;
+  uint32_t in_epoch_ = 0;
+  uint32_t out_epoch_ = 0;
+  uint64_t out_samples_ = 0;
+  std::atomic<bool> sq_open_{true};
+  std::atomic<float> power_db_{0.0f};
+  std::atomic<uint64_t> gated_{0};
+};
+
+// Channel -> MPX (quadrature discriminator).
+class FMDemodBlock : public FlowBlock {
+public:
+  explicit FMDemodBlock(FMDemodulator& demod);
+
+  InPort<SplitIQBuffer> in{this};
+  OutPort<AlignedFloats> out{this};
+
+  bool work() override;
+
+private:
+  FMDemodulator& demod_;
+  uint32_t epoch_ = 0;
+};
+
+// MPX -> RDS groups. Sink; idles at tier >= 1 or while the tag turns RDS
+// off, and restarts when it resumes.
+class RDSBlock : public FlowBlock {
+public:
+  explicit RDSBlock(RDSDecoder& rds);
+
+  InPort<AlignedFloats> in{this};
+
+  bool work() override;
+
+  // ChunkTag::ctl of the last chunk decoded (or skipped).
+  uint32_t ctl_seen() const { return ctl_seen_; }
+  // Tag of the chunk being decoded, for the decoder's callbacks.
+  const ChunkTag& tag() const { return tag_; }
+
+private:
+  RDSDecoder& rds_;
+  ChunkTag tag_;
+  bool on_ = false;
+  uint32_t epoch_ = 0;
+  std::atomic<uint32_t> ctl_seen_{0};
+};
+
+// MPX -> PCM at the audio rate, mono or interleaved stereo. Stereo falls
+// back to the mono path at tier >= 2. Gated chunks become silence at the
+// audio rate, or an empty chunk when emit_silence is false; every input yields
+// one output so the sink sees each control sequence.
+class AudioBlock : public FlowBlock {
+public:
+  AudioBlock(AudioResampler& mono, StereoDecoder* stereo, double fs_mpx, double fs_audio,
+             bool emit_silence);
+
+  InPort<AlignedFloats> in{this};
+  OutPort<AlignedVector<int16_t>> out{this};
+
+  bool work() override;
+
+private:
+  AudioResampler& mono_;
+  StereoDecoder* stereo_;
+  double ratio_;
+  bool emit_silence_;
+  double frac_ = 0.0;
+  uint32_t epoch_ = 0;
+  int tier_ = 0;
+  float gain_ = -1.0f;
+};
+
+// PCM -> AudioBroadcast, keeping the capture timestamp.
+class AudioRingSinkBlock : public FlowBlock {
+public:
+  explicit AudioRingSinkBlock(AudioBroadcast& rb);
+
+  InPort<AlignedVector<int16_t>> in{this};
+
+  bool work() override;
+
+  // ChunkTag::ctl of the last chunk handed to the audio sinks.
+  uint32_t ctl_seen() const { return ctl_seen_; }
+
+private:
+  AudioBroadcast& rb_;
+  std::atomic<uint32_t> ctl_seen_{0};
+};
+
+// MPX -> compact capture file (MpxFile.h) for offline reprocessing.
+// Connect it with connect_lossy so a slow disk never stalls the receiver;
+// chunks it misses are written as gated spans, keeping the file's sample
+// count in step with the capture.
+class MpxTapBlock : public FlowBlock {
+public:
+  explicit MpxTapBlock(MpxWriter& w);
+
+  InPort<AlignedFloats> in{this};
+
+  bool work() override;
+
+  // After the graph has finished: records chunks dropped at the end of
+  // the stream as a gap up to sample end.
+  void pad_to(uint64_t end);
+  // Samples lost to dropped chunks (recorded as gaps).
+  uint64_t gap_samples() const { return gap_samples_; }
+
+private:
+  MpxWriter& w_;
+  uint64_t next_ = 0;        // ChunkTag::sample expected next
+  ChunkTag last_;
+  std::atomic<uint64_t> gap_samples_{0};
+};
+
+// IQ -> averaged power spectra (SpectrumMonitor.h). Connect it with
+// connect_lossy: it sees the chunks it keeps up with and never holds the
+// receiver back. center gives the RF frequency at the middle of the input.
+class SpectrumTapBlock : public FlowBlock {
+public:
+  SpectrumTapBlock(const char* name, SpectrumMonitor& mon, std::function<double(const ChunkTag&)> center);
+
+  InPort<SplitIQBuffer> in{this};
+
+  bool work() override;
+
+private:
+  SpectrumMonitor& mon_;
+  std::function<double(const ChunkTag&)> center_;
+  uint32_t epoch_ = 0;
+};
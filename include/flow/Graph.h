@@ -0,0 +1,354 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Config.h"
+#include "RealTime.h"
+
+// Small dataflow runtime. Blocks exchange reference-counted chunks through
+// bounded queues: a chunk is written once and shared read-only by every
+// reader of the port (no copies on fan-out), a full queue blocks the writer
+// (backpressure). By default one thread runs every block in turn; threaded
+// mode gives each block its own thread so independent branches proceed on
+// different cores.
+
+// Control travels in-band with the samples, so every block applies a retune,
+// a squelch transition or a quality change at the same sample boundary.
+struct ChunkTag {
+  uint64_t t_ns = 0;        // capture time of the last sample (LatencyStats.h)
+  uint32_t epoch = 0;       // changes when downstream state must restart
+  int tier = 0;             // overload governor tier
+  double offset_hz = 0.0;   // channel offset in effect for this epoch
+  double lo_hz = 0.0;       // LO the IQ was captured at; the station is lo_hz + offset_hz
+  bool gated = false;       // squelch closed: no signal, n still counts samples
+  float audio_gain = DEFAULT_AUDIO_GAIN;  // applied by the audio stage
+  bool rds = true;          // RDS decoding on
+  uint32_t ctl = 0;         // last live control change this chunk reflects
+  uint64_t sample = 0;      // first sample's index in the channel stage output (0 upstream of it)
+};
+
+template <class T>
+struct Chunk {
+  T data;
+  size_t n = 0;
+  ChunkTag tag;
+};
+
+template <class T>
+using ChunkPtr = std::shared_ptr<const Chunk<T>>;
+
+class FlowBlock;
+
+class QueueBase {
+public:
+  virtual ~QueueBase() = default;
+  virtual void close() = 0;
+  // A chunk is queued or the stream has ended: pop() will not wait.
+  virtual bool ready() = 0;
+};
+
+template <class T>
+class ChunkQueue : public QueueBase {
+public:
+  // lossy: a full queue drops the incoming chunk instead of blocking.
+  explicit ChunkQueue(size_t depth, bool lossy = false) : depth_(depth ? depth : 1), lossy_(lossy) {}
+
+  // Blocks while full (lossy: drops the chunk); false once closed.
+  bool push(ChunkPtr<T> c) {
+    std::unique_lock<std::mutex> lock(m_);
+    if (lossy_ && !closed_ && q_.size() >= depth_) {
+      dropped_++;
+      return true;
+    }
+    not_full_.wait(lock, [&]{ return closed_ || q_.size() < depth_; });
+    if (closed_) return false;
+    q_.push_back(std::move(c));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // Blocks while empty; nullptr once closed and drained.
+  ChunkPtr<T> pop() {
+    std::unique_lock<std::mutex> lock(m_);
+    not_empty_.wait(lock, [&]{ return closed_ || !q_.empty(); });
+    if (q_.empty()) return nullptr;
+    ChunkPtr<T> c = std::move(q_.front());
+    q_.pop_front();
+    not_full_.notify_one();
+    return c;
+  }
+
+  void close() override {
+    std::lock_guard<std::mutex> lock(m_);
+    closed_ = true;
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+  bool ready() override {
+    std::lock_guard<std::mutex> lock(m_);
+    return closed_ || !q_.empty();
+  }
+
+  uint64_t dropped() const { return dropped_; }
+
+private:
+  size_t depth_;
+  bool lossy_;
+  std::atomic<uint64_t> dropped_{0};
+  std::deque<ChunkPtr<T>> q_;
+  bool closed_ = false;
+  std::mutex m_;
+  std::condition_variable not_full_, not_empty_;
+};
+
+class OutPortBase {
+public:
+  explicit OutPortBase(FlowBlock* owner);
+  virtual ~OutPortBase() = default;
+  virtual void close() = 0;
+
+protected:
+  FlowBlock* owner_;
+};
+
+template <class T>
+class OutPort : public OutPortBase {
+public:
+  explicit OutPort(FlowBlock* owner) : OutPortBase(owner), pool_(std::make_shared<Pool>()) {}
+
+  // A writable chunk, recycled from earlier pushes once all readers let go.
+  // Payload capacity is kept, so steady state does not allocate.
+  // Fill the pool ahead of streaming so the first chunks do not allocate or
+  // page-fault; init sizes (and so touches) each payload.
+  template <class Init>
+  void prime(size_t count, Init init) {
+    std::lock_guard<std::mutex> lock(pool_->m);
+    while (pool_->free.size() < count) {
+      std::unique_ptr<Chunk<T>> c(new Chunk<T>());
+      init(c->data);
+      pool_->free.push_back(std::move(c));
+    }
+  }
+
+  std::shared_ptr<Chunk<T>> acquire() {
+    std::unique_ptr<Chunk<T>> c;
+    {
+      std::lock_guard<std::mutex> lock(pool_->m);
+      if (!pool_->free.empty()) {
+        c = std::move(pool_->free.back());
+        pool_->free.pop_back();
+      }
+    }
+    if (!c) c.reset(new Chunk<T>());
+    c->n = 0;
+    c->tag = ChunkTag();
+    std::weak_ptr<Pool> wp = pool_;
+    return std::shared_ptr<Chunk<T>>(c.release(), [wp](Chunk<T>* p) {
+      if (auto pool = wp.lock()) {
+        std::lock_guard<std::mutex> lock(pool->m);
+        pool->free.emplace_back(p);
+      } else {
+        delete p;
+      }
+    });
+  }
+
+  // Hands the chunk to every reader; false when the graph is shutting down.
+  bool push(ChunkPtr<T> c);
+
+  void close() override {
+    for (auto& r : readers_) r->close();
+  }
+
+  void add_reader(std::shared_ptr<ChunkQueue<T>> q) { readers_.push_back(std::move(q)); }
+  bool connected() const { return !readers_.empty(); }
+
+private:
+  struct Pool {
+    std::mutex m;
+    std::vector<std::unique_ptr<Chunk<T>>> free;
+  };
+  std::shared_ptr<Pool> pool_;
+  std::vector<std::shared_ptr<ChunkQueue<T>>> readers_;
+};
+
+template <class T>
+class InPort {
+public:
+  explicit InPort(FlowBlock* owner) : owner_(owner) {}
+
+  // Next chunk, nullptr at end of stream.
+  ChunkPtr<T> pop();
+
+  // lossy: the owner is a monitor (FlowBlock::monitor()).
+  void attach(std::shared_ptr<ChunkQueue<T>> q, bool lossy);
+  bool connected() const { return q_ != nullptr; }
+  // Chunks a lossy connection discarded before this reader saw them.
+  uint64_t dropped() const { return q_ ? q_->dropped() : 0; }
+
+private:
+  FlowBlock* owner_;
+  std::shared_ptr<ChunkQueue<T>> q_;
+};
+
+class FlowBlock {
+public:
+  explicit FlowBlock(std::string name) : name_(std::move(name)) {}
+  virtual ~FlowBlock() = default;
+
+  // Process one chunk: pop inputs, compute, push outputs. Return false at
+  // end of stream; the runtime then closes this block's outputs.
+  virtual bool work() = 0;
+
+  const std::string& name() const { return name_; }
+  // Time spent computing, excluding waits on ports.
+  uint64_t busy_ns() const { return busy_ns_; }
+  // Applied by the block's own thread when the graph starts (threaded
+  // mode); a serial graph runs under the first block's policy.
+  void set_thread_policy(const ThreadPolicy& p) { policy_ = p; }
+  // Fed through connect_lossy: it drops chunks rather than slow the graph,
+  // so its compute time does not bound throughput.
+  bool monitor() const { return monitor_; }
+
+protected:
+  void add_wait(uint64_t ns) { wait_ns_ += ns; }
+
+private:
+  friend class FlowGraph;
+  friend class OutPortBase;
+  template <class T> friend class OutPort;
+  template <class T> friend class InPort;
+
+  // One timed work() call.
+  bool step();
+  // Every input can be popped without waiting; false for sources.
+  bool ready() const;
+  void run();
+  void close_outputs();
+
+  std::string name_;
+  std::vector<OutPortBase*> outs_;
+  std::vector<QueueBase*> ins_;
+  bool monitor_ = false;
+  ThreadPolicy policy_;
+  uint64_t wait_ns_ = 0;              // owner thread only
+  std::atomic<uint64_t> busy_ns_{0};
+};
+
+// Source driven by a callback that fills one chunk at a time.
+template <class T>
+class SourceBlock : public FlowBlock {
+public:
+  using Fill = std::function<bool(Chunk<T>&)>;
+  SourceBlock(std::string name, Fill fill) : FlowBlock(std::move(name)), fill_(std::move(fill)) {}
+
+  OutPort<T> out{this};
+
+  // For fill callbacks: time spent blocked on an external producer.
+  void note_wait(uint64_t ns) { add_wait(ns); }
+
+  bool work() override {
+    auto c = out.acquire();
+    if (!fill_(*c)) return false;
+    return out.push(c);
+  }
+
+private:
+  Fill fill_;
+};
+
+class FlowGraph {
+public:
+  FlowGraph() = default;
+  ~FlowGraph();
+  FlowGraph(const FlowGraph&) = delete;
+  FlowGraph& operator=(const FlowGraph&) = delete;
+
+  template <class B, class... Args>
+  B* add(Args&&... args) {
+    B* b = new B(std::forward<Args>(args)...);
+    blocks_.emplace_back(b);
+    return b;
+  }
+
+  // depth: chunks the reader may fall behind before the writer blocks.
+  template <class T>
+  void connect(OutPort<T>& out, InPort<T>& in, size_t depth = 4) {
+    auto q = std::make_shared<ChunkQueue<T>>(depth);
+    out.add_reader(q);
+    in.attach(q, false);
+    queues_.push_back(q);
+  }
+
+  // For monitors: the writer never waits on this reader; chunks arriving
+  // while depth are already queued are dropped (InPort::dropped()). A
+  // serial graph drains every queue before the source runs again, so
+  // there a monitor drops nothing and costs its full compute time.
+  template <class T>
+  void connect_lossy(OutPort<T>& out, InPort<T>& in, size_t depth = 2) {
+    auto q = std::make_shared<ChunkQueue<T>>(depth, true);
+    out.add_reader(q);
+    in.attach(q, true);
+    queues_.push_back(q);
+  }
+
+  // threaded: one thread per block. Otherwise a single thread runs the
+  // blocks in turn: whatever has input, in the order they were added,
+  // then the sources once more. No port ever waits, so on one core this
+  // costs no more than a hand-written loop.
+  void start(bool threaded = false);
+  // Waits for every block to reach end of stream.
+  void wait();
+  // Closes all queues (aborting in-flight chunks) and joins.
+  void stop();
+
+  // Compute time of the busiest block other than monitors: the throughput
+  // limit of a threaded graph.
+  uint64_t max_busy_ns() const;
+  const std::vector<std::unique_ptr<FlowBlock>>& blocks() const { return blocks_; }
+  bool threaded() const { return threaded_; }
+
+private:
+  void run_serial();
+
+  bool threaded_ = false;
+  std::vector<std::unique_ptr<FlowBlock>> blocks_;
+  std::vector<std::shared_ptr<QueueBase>> queues_;
+  std::vector<std::thread> threads_;
+};
+
+uint64_t flow_now_ns();
+
+template <class T>
+bool OutPort<T>::push(ChunkPtr<T> c) {
+  uint64_t t0 = flow_now_ns();
+  bool ok = true;
+  for (auto& r : readers_) ok = r->push(c) && ok;
+  owner_->add_wait(flow_now_ns() - t0);
+  return ok;
+}
+
+template <class T>
+void InPort<T>::attach(std::shared_ptr<ChunkQueue<T>> q, bool lossy) {
+  owner_->ins_.push_back(q.get());
+  owner_->monitor_ = owner_->monitor_ || lossy;
+  q_ = std::move(q);
+}
+
+template <class T>
+ChunkPtr<T> InPort<T>::pop() {
+  if (!q_) return nullptr;
+  uint64_t t0 = flow_now_ns();
+  ChunkPtr<T> c = q_->pop();
+  owner_->add_wait(flow_now_ns() - t0);
+  return c;
+}
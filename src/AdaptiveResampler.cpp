@@ -0,0 +1,92 @@
+#include "AdaptiveResampler.h"
+#include "Logging.h"
+#include <algorithm>
+#include <cmath>
+
+// Loop gains: ppm per second of fill error, and ppm per (second of error * second).
+// With the sink as an integrator this gives ~0.07 rad/s, damping ~0.7.
+static constexpr double KP = 1e5;
+static constexpr double KI = 5e3;
+static constexpr double MAX_PPM = 2000.0;
+static constexpr double FILL_TAU_S = 0.5;
+
+AdaptiveResampler::AdaptiveResampler(AudioReader& in, double fs, double target_fill_ms)
+  : in_(in), ch_(in.channels()), fs_(fs), farrow_(ch_, FarrowResamplerR(1.0)), pend_(ch_), outf_(ch_) {
+  target_ = fs_ * target_fill_ms / 1000.0;
+  fill_f_ = target_;
+}
+
+bool AdaptiveResampler::prime() {
+  size_t need = size_t(target_) * ch_;
+  if (!in_.wait_for(need)) return false;
+
+  // Start exactly at the target: backlog queued before the sink started is
+  // discarded once here rather than being drained slowly by the loop.
+  size_t avail = in_.available();
+  if (avail > need) {
+    tmp_.resize(avail - need);
+    uint64_t t_ns = 0;
+    in_.pop(tmp_.data(), tmp_.size(), t_ns);
+  }
+  pend_n_ = 0;
+  fill_f_ = target_;
+  integ_ = 0.0;
+  return true;
+}
+
+size_t AdaptiveResampler::pull(int16_t* out, size_t n, uint64_t& t_ns) {
+  size_t have = 0;
+  while (have < n) {
+    size_t made = 0, consumed = 0;
+    for (size_t c = 0; c < ch_; ++c) {
+      std::vector<float>& p = pend_[c];
+      if (outf_[c].size() < n) outf_[c].resize(n);
+      made = farrow_[c].process(p.data(), pend_n_, consumed, outf_[c].data() + have, n - have);
+      std::copy(p.begin() + consumed, p.begin() + pend_n_, p.begin());
+    }
+    have += made;
+    pend_n_ -= consumed;
+    if (have >= n) break;
+
+    // need roughly (n - have) * ratio more input frames
+    size_t want = size_t(double(n - have) * (1.0 + MAX_PPM * 1e-6)) + 2;
+    tmp_.resize(want * ch_);
+    size_t got = in_.pop(tmp_.data(), tmp_.size(), t_ns) / ch_;
+    if (got == 0) break;
+    for (size_t c = 0; c < ch_; ++c) {
+      std::vector<float>& p = pend_[c];
+      if (p.size() < pend_n_ + got) p.resize(pend_n_ + got);
+      for (size_t i = 0; i < got; ++i) p[pend_n_ + i] = float(tmp_[i * ch_ + c]);
+    }
+    pend_n_ += got;
+  }
+
+  for (size_t c = 0; c < ch_; ++c) {
+    for (size_t i = 0; i < have; ++i) {
+      float v = std::max(-32768.0f, std::min(32767.0f, outf_[c][i]));
+      out[i * ch_ + c] = int16_t(std::lrintf(v));
+    }
+  }
+  update_loop(have);
+  return have;
+}
+
+void AdaptiveResampler::update_loop(size_t produced) {
+  if (produced == 0) return;
+  double dt = double(produced) / fs_;
+
+  // pending input counts as buffered: it is audio not yet played out
+  double fill = double(in_.available() / ch_ + pend_n_);
+  double a = 1.0 - std::exp(-dt / FILL_TAU_S);
+  fill_f_ += a * (fill - fill_f_);
+
+  double err_s = (fill_f_ - target_) / fs_;
+  integ_ = std::max(-MAX_PPM, std::min(MAX_PPM, integ_ + KI * err_s * dt));
+  double ppm = std::max(-MAX_PPM, std::min(MAX_PPM, KP * err_s + integ_));
+
+  // fill above target: producer is fast, consume more input per output
+  for (auto& f : farrow_) f.set_ratio(1.0 / (1.0 + ppm * 1e-6));
+
+  ppm_est_ = integ_;
+  fill_ms_ = 1000.0 * fill_f_ / fs_;
+}
@@ -0,0 +1,132 @@
+#include "AudioBroadcast.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static constexpr size_t MAX_MARKS = 4096;
+
+AudioBroadcast::AudioBroadcast(size_t capacity_samples, uint16_t channels, HugePages hp)
+  : ch_(channels ? channels : 1), hp_(hp) {
+  cap_ = std::max<size_t>(ch_, capacity_samples - capacity_samples % ch_);
+}
+
+bool AudioBroadcast::init() {
+  if (buf_) return true;
+  if (!mem_.map(cap_ * sizeof(int16_t), hp_, -1, "audio ring")) return false;
+  buf_ = static_cast<int16_t*>(mem_.data());
+  return true;
+}
+
+AudioReader& AudioBroadcast::add_reader(const std::string& name, size_t max_lag_samples, AudioOverrun policy) {
+  std::lock_guard<std::mutex> lock(m_);
+  size_t lag = (max_lag_samples == 0 || max_lag_samples > cap_) ? cap_ : max_lag_samples;
+  lag = std::max<size_t>(ch_, lag - lag % ch_);
+  readers_.emplace_back(new AudioReader(*this, name, lag, policy, w_total_));
+  return *readers_.back();
+}
+
+void AudioBroadcast::push(const int16_t* samples, size_t count, uint64_t t_ns) {
+  count -= count % ch_;
+  if (count == 0) return;
+  uint64_t at;
+  {
+    std::lock_guard<std::mutex> lock(m_);
+    if (stopped_) return;
+    // a block longer than the ring keeps only its newest frames
+    if (count > cap_) {
+      samples += count - cap_;
+      w_total_ += count - cap_;
+      count = cap_;
+    }
+    at = w_total_;
+    // readers behind this point skip ahead (catch_up)
+    if (at + count > cap_) tail_ = std::max(tail_, at + count - cap_);
+  }
+
+  // Unlocked: readers copy only [tail_, w_total_), under m_, and this
+  // writes the slots of samples before tail_ and after w_total_.
+  size_t pos = size_t(at % cap_);
+  size_t first = std::min(count, cap_ - pos);
+  std::memcpy(buf_ + pos, samples, first * sizeof(int16_t));
+  std::memcpy(buf_, samples + first, (count - first) * sizeof(int16_t));
+
+  std::lock_guard<std::mutex> lock(m_);
+  w_total_ = at + count;
+  if (t_ns != 0) {
+    if (marks_.size() == MAX_MARKS) marks_.pop_front();
+    marks_.emplace_back(w_total_, t_ns);
+  }
+  while (!marks_.empty() && marks_.front().first <= tail_) marks_.pop_front();
+  cv_.notify_all();
+}
+
+// The first mark ending at or after `end` covers the sample before it.
+uint64_t AudioBroadcast::mark_for(uint64_t end) const {
+  auto it = std::lower_bound(marks_.begin(), marks_.end(), end,
+                             [](const std::pair<uint64_t, uint64_t>& m, uint64_t e) { return m.first < e; });
+  return it == marks_.end() ? 0 : it->second;
+}
+
+void AudioBroadcast::stop() {
+  std::lock_guard<std::mutex> lock(m_);
+  stopped_ = true;
+  cv_.notify_all();
+}
+
+uint16_t AudioReader::channels() const { return b_.ch_; }
+
+void AudioReader::catch_up() {
+  uint64_t w = b_.w_total_;
+  uint64_t oldest = std::max(b_.tail_, w > max_lag_ ? w - max_lag_ : 0);
+  if (r_ >= oldest) return;
+  uint64_t to = policy_ == AudioOverrun::Resync ? w : oldest;
+  dropped_ += to - r_;
+  r_ = to;
+}
+
+bool AudioReader::ready() const { return b_.stopped_ || stopped_ || b_.w_total_ > r_; }
+
+size_t AudioReader::pop(int16_t* out, size_t max_count, uint64_t& t_ns) {
+  return pop_for(out, max_count, t_ns, -1);
+}
+
+size_t AudioReader::pop_for(int16_t* out, size_t max_count, uint64_t& t_ns, int timeout_ms) {
+  std::unique_lock<std::mutex> lock(b_.m_);
+  if (timeout_ms < 0) b_.cv_.wait(lock, [&]{ return ready(); });
+  else b_.cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&]{ return ready(); });
+
+  t_ns = 0;
+  catch_up();
+  size_t n = size_t(std::min<uint64_t>(max_count, b_.w_total_ - r_));
+  n -= n % b_.ch_;
+  if (n == 0) return 0;
+  // with m_ held the writer cannot move tail_ past r_, so none of these
+  // samples is overwritten while they are copied
+  size_t pos = size_t(r_ % b_.cap_);
+  size_t first = std::min(n, b_.cap_ - pos);
+  std::memcpy(out, b_.buf_ + pos, first * sizeof(int16_t));
+  std::memcpy(out + first, b_.buf_, (n - first) * sizeof(int16_t));
+  t_ns = b_.mark_for(r_ + n);
+  r_ += n;
+  return n;
+}
+
+size_t AudioReader::available() {
+  std::lock_guard<std::mutex> lock(b_.m_);
+  catch_up();
+  return size_t(b_.w_total_ - r_);
+}
+
+bool AudioReader::wait_for(size_t n) {
+  std::unique_lock<std::mutex> lock(b_.m_);
+  n = std::min(n, max_lag_);
+  b_.cv_.wait(lock, [&]{ return b_.stopped_ || stopped_ || b_.w_total_ - r_ >= n; });
+  catch_up();
+  return !b_.stopped_ && !stopped_;
+}
+
+void AudioReader::stop() {
+  std::lock_guard<std::mutex> lock(b_.m_);
+  stopped_ = true;
+  b_.cv_.notify_all();
+}
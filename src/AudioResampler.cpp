@@ -1,12 +1,18 @@
 #include "AudioResampler.h"
 #include "dsp/FirDesign.h"
+#include "Logging.h"
 #include <algorithm>
 #include <cmath>
 
-AudioResampler::AudioResampler(double fs_in, uint32_t decim_to_48k, float deemph_tau_s, float audio_cut_hz)
-  : fs_in_(fs_in), decim_(decim_to_48k) {
+// Largest interpolation factor worth a polyphase bank; beyond it use Farrow.
+static constexpr uint32_t MAX_INTERP = 256;
+static constexpr int NTAPS = 161;
+static constexpr int RATIONAL_TAPS_PER_PHASE = 128;
+static constexpr int NTAPS_LOW_COST = 61;
+static constexpr int RATIONAL_TAPS_PER_PHASE_LOW_COST = 48;
 
-  fs_out_ = fs_in_ / double(decim_);
+AudioResampler::AudioResampler(double fs_in, double fs_out, float deemph_tau_s, float audio_cut_hz)
+  : fs_in_(fs_in), fs_out_(fs_out) {
 
   // 1st order de-emphasis: y[n] = y[n-1] + a*(x[n] - y[n-1])
   // a = dt / (tau + dt)
@@ -14,13 +20,54 @@ AudioResampler::AudioResampler(double fs_in, uint32_t decim_to_48k, float deemph
   a_ = float(dt / (double(deemph_tau_s) + dt));
   y_ = 0.0f;
 
-  // Audio lowpass and decimator
-  int ntaps = 161;
-  auto taps = design_lowpass(float(fs_in_), audio_cut_hz, ntaps);
-  dec_ = FIRDecimatorR(taps, decim_);
+  // discriminator output is rad/sample; full scale = 75 kHz deviation
+  scale_ = float(fs_in_ / (2.0 * M_PI * 75000.0));
+
+  cut_ = std::min(audio_cut_hz, float(0.45 * fs_out_));
+
+  bool exact = rational_approx(fs_out_ / fs_in_, 1u << 20, L_, M_);
+  if (exact && L_ == 1) {
+    mode_ = Mode::Integer;
+    log_msg(LogLevel::Info, "AudioResampler: %.0f -> %.0f Hz, decim %u", fs_in_, fs_out_, M_);
+  } else if (exact && L_ <= MAX_INTERP) {
+    mode_ = Mode::Rational;
+    log_msg(LogLevel::Info, "AudioResampler: %.3f -> %.0f Hz, polyphase %u/%u", fs_in_, fs_out_, L_, M_);
+  } else {
+    // Lowpass (and integer pre-decimate while staying >= 2x oversampled),
+    // then cubic Farrow for the remaining fractional ratio.
+    mode_ = Mode::Farrow;
+    D_ = std::max<uint32_t>(1, uint32_t(fs_in_ / (2.0 * fs_out_)));
+    log_msg(LogLevel::Info, "AudioResampler: %.3f -> %.0f Hz, decim %u + Farrow %.6f",
+            fs_in_, fs_out_, D_, fs_out_ / (fs_in_ / double(D_)));
+  }
+
+  build(full_, NTAPS, RATIONAL_TAPS_PER_PHASE);
+  build(lite_, NTAPS_LOW_COST, RATIONAL_TAPS_PER_PHASE_LOW_COST);
+}
+
+void AudioResampler::build(Filters& f, int ntaps, int taps_per_phase) {
+  if (mode_ == Mode::Integer) {
+    f.dec = FIRDecimatorR(design_lowpass(float(fs_in_), cut_, ntaps), M_);
+  } else if (mode_ == Mode::Rational) {
+    f.rat = RationalResamplerR(design_lowpass(float(fs_in_ * L_), cut_, int(L_) * taps_per_phase), L_, M_);
+  } else {
+    f.dec = FIRDecimatorR(design_lowpass(float(fs_in_), cut_, ntaps), D_);
+    f.farrow = FarrowResamplerR(fs_out_ / (fs_in_ / double(D_)));
+  }
+}
+
+void AudioResampler::reset() {
+  y_ = 0.0f;
+  full_.reset();
+  lite_.reset();
 }
 
-void AudioResampler::reset() { y_ = 0.0f; dec_.reset(); }
+void AudioResampler::set_low_cost(bool en) {
+  Filters* next = en ? &lite_ : &full_;
+  if (next == f_) return;
+  next->reset();
+  f_ = next;
+}
 
 size_t AudioResampler::process(const float* in_mpx, size_t n_in,
                                int16_t* out_pcm, size_t out_cap) {
@@ -31,13 +78,22 @@ size_t AudioResampler::process(const float* in_mpx, size_t n_in,
     tmp_[i] = y_;
   }
 
-  // lowpass + decimate
-  tmp2_.resize(out_cap);
-  size_t n_out = dec_.process(tmp_.data(), n_in, tmp2_.data(), out_cap);
+  // lowpass + rate conversion
+  tmp2_.resize(std::max(out_cap, n_in));
+  size_t n_out = 0;
+  if (mode_ == Mode::Integer) {
+    n_out = f_->dec.process(tmp_.data(), n_in, tmp2_.data(), out_cap);
+  } else if (mode_ == Mode::Rational) {
+    n_out = f_->rat.process(tmp_.data(), n_in, tmp2_.data(), out_cap);
+  } else {
+    tmp3_.resize(n_in);
+    size_t n_mid = f_->dec.process(tmp_.data(), n_in, tmp3_.data(), tmp3_.size());
+    n_out = f_->farrow.process(tmp3_.data(), n_mid, tmp2_.data(), out_cap);
+  }
 
   // scale to int16
   for (size_t i = 0; i < n_out; ++i) {
-    float v = tmp2_[i] * gain_;
+    float v = tmp2_[i] * scale_ * gain_;
     v = std::max(-1.0f, std::min(1.0f, v));
     out_pcm[i] = int16_t(std::lrintf(v * 32767.0f));
   }
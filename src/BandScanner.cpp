@@ -0,0 +1,174 @@
+#include "BandScanner.h"
+#include "ChannelFilter.h"
+#include "FMDemodulator.h"
+#include "RDSDecoder.h"
+#include "Logging.h"
+#include "dsp/FFT.h"
+#include "dsp/FirDesign.h"
+#include "dsp/FIRDecimator.h"
+#include "dsp/IQConvert.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+static constexpr double BAND_LO_HZ = 87.5e6;
+static constexpr double BAND_HI_HZ = 108.0e6;
+static constexpr double RASTER_HZ = 100000.0;
+static constexpr double CHAN_HALF_BW_HZ = 80000.0;   // power integration half width
+static constexpr double DC_GUARD_HZ = 150000.0;      // ignore the LO spike region
+static constexpr size_t FFT_N = 4096;
+static constexpr size_t FFT_AVG = 64;
+static constexpr double SETTLE_S = 0.01;
+static constexpr float DETECT_SNR_DB = 10.0f;
+
+BandScanner::BandScanner(const ReceiverConfig& cfg) : cfg_(cfg), dev_(make_iq_source(cfg.device, cfg)) {}
+
+void BandScanner::on_iq(const uint8_t* iq, size_t bytes) {
+  std::lock_guard<std::mutex> lock(m_);
+  if (!cap_buf_) return;
+  size_t skip = std::min(cap_skip_, bytes);
+  cap_skip_ -= skip;
+  iq += skip;
+  bytes -= skip;
+  size_t take = std::min(cap_want_ - cap_buf_->size(), bytes);
+  cap_buf_->insert(cap_buf_->end(), iq, iq + take);
+  if (cap_buf_->size() >= cap_want_) {
+    cap_buf_ = nullptr;
+    cv_.notify_all();
+  }
+}
+
+bool BandScanner::capture(size_t skip, size_t want, std::vector<uint8_t>& buf) {
+  std::unique_lock<std::mutex> lock(m_);
+  buf.clear();
+  buf.reserve(want);
+  cap_skip_ = skip;
+  cap_want_ = want;
+  cap_buf_ = &buf;
+  bool ok = cv_.wait_for(lock, std::chrono::seconds(5), [&]{ return cap_buf_ == nullptr; });
+  cap_buf_ = nullptr;
+  if (!ok) log_msg(LogLevel::Error, "Scan: IQ capture timed out");
+  return ok;
+}
+
+void BandScanner::decode_rds(const std::vector<uint8_t>& raw, double lo_hz, ScanResult& r) {
+  // Translate and decimate to ~2 MS/s first so the normal channel filter
+  // (161 taps) has a narrow transition at its input rate.
+  const double fs = cfg_.scan_rate_hz;
+  uint32_t d1 = std::max<uint32_t>(1, uint32_t(fs / 2e6));
+  double fs1 = fs / double(d1);
+  FIRDecimatorXlate pre(design_lowpass(float(fs), 300000.0f, 161), d1, fs, r.freq_hz - lo_hz);
+  ChannelFilter chan(fs1, ChannelFilter::auto_decim(fs1, cfg_.audio_rate_hz), cfg_.channel_cut_hz);
+  FMDemodulator demod;
+  RDSDecoder rds(chan.fs_out());
+
+  const size_t blk = 65536;
+  std::vector<std::complex<float>> iq(blk), mid(blk / d1 + 8), ch(blk / d1 + 8);
+  std::vector<float> mpx(ch.size());
+  for (size_t off = 0; off + 2 * blk <= raw.size(); off += 2 * blk) {
+    iq_s8_to_cf32(raw.data() + off, blk, iq.data());
+    size_t n1 = pre.process(iq.data(), blk, mid.data(), mid.size());
+    size_t n2 = chan.process(mid.data(), n1, ch.data(), ch.size());
+    size_t n3 = demod.process(ch.data(), n2, mpx.data(), mpx.size());
+    rds.process(mpx.data(), n3);
+  }
+  r.pi = rds.program_id();
+  r.ps = rds.program_service();
+}
+
+bool BandScanner::run(std::vector<ScanResult>& out) {
+  out.clear();
+  const double fs = cfg_.scan_rate_hz;
+  const double half = 0.35 * fs;   // usable half span inside the baseband filter
+
+  // Fewest LO steps that reach both band edges while every step's DC hole
+  // lies inside a neighbour's usable span (hence at least two).
+  double band = BAND_HI_HZ - BAND_LO_HZ;
+  double first = BAND_LO_HZ + half - CHAN_HALF_BW_HZ;
+  double last = std::max(first, BAND_HI_HZ - half + CHAN_HALF_BW_HZ);
+  double max_spacing = half - DC_GUARD_HZ - CHAN_HALF_BW_HZ;
+  size_t steps = std::max<size_t>(2, size_t(std::ceil((last - first) / max_spacing)) + 1);
+  std::vector<double> los;
+  for (size_t i = 0; i < steps; ++i) {
+    los.push_back(first + (last - first) * double(i) / double(steps - 1));
+  }
+
+  dev_->set_baseband_bw_hz(uint32_t(0.75 * fs));
+  if (!dev_->open()) return false;
+  if (!dev_->configure(los[0], fs, cfg_.lna_gain_db, cfg_.vga_gain_db)) return false;
+  if (!dev_->start_rx([this](const uint8_t* iq, size_t n){ on_iq(iq, n); })) return false;
+
+  auto t0 = std::chrono::steady_clock::now();
+  FFT fft(FFT_N);
+  auto win = blackman_harris(FFT_N);
+  double win_pow = 0.0;
+  for (float w : win) win_pow += double(w) * w;
+  const double bin_hz = fs / double(FFT_N);
+
+  size_t n_ch = size_t(std::lround(band / RASTER_HZ)) + 1;
+  std::vector<float> ch_db(n_ch, -200.0f);
+  std::vector<float> ch_dist(n_ch, 1e30f);   // |f - LO| of the step that measured it
+  std::vector<size_t> ch_step(n_ch, 0);
+  std::vector<std::vector<uint8_t>> dwell(los.size());
+
+  size_t settle = USB_TRANSFER_BYTES + size_t(fs * 2.0 * SETTLE_S);
+  size_t spec_bytes = FFT_N * FFT_AVG * 2;
+  size_t dwell_bytes = cfg_.scan_rds ? size_t(fs * cfg_.scan_dwell_s) * 2 : 0;
+
+  std::vector<uint8_t> raw;
+  std::vector<std::complex<float>> buf(FFT_N);
+  std::vector<double> psd(FFT_N);
+  for (size_t s = 0; s < los.size(); ++s) {
+    if (s > 0 && !dev_->set_frequency(los[s])) { dev_->close(); return false; }
+    if (!capture(settle, std::max(spec_bytes, dwell_bytes), raw)) { dev_->close(); return false; }
+
+    std::fill(psd.begin(), psd.end(), 0.0);
+    for (size_t a = 0; a < FFT_AVG; ++a) {
+      iq_s8_to_cf32(raw.data() + a * FFT_N * 2, FFT_N, buf.data());
+      for (size_t i = 0; i < FFT_N; ++i) buf[i] *= win[i];
+      fft.forward(buf.data());
+      for (size_t i = 0; i < FFT_N; ++i) psd[i] += std::norm(buf[i]);
+    }
+
+    for (size_t c = 0; c < n_ch; ++c) {
+      double f = BAND_LO_HZ + double(c) * RASTER_HZ;
+      double off = f - los[s];
+      double dist = std::fabs(off);
+      if (dist > half || dist < DC_GUARD_HZ || float(dist) >= ch_dist[c]) continue;
+      long b0 = std::lround((off - CHAN_HALF_BW_HZ) / bin_hz);
+      long b1 = std::lround((off + CHAN_HALF_BW_HZ) / bin_hz);
+      double p = 0.0;
+      for (long b = b0; b <= b1; ++b) p += psd[size_t((b + long(FFT_N)) % long(FFT_N))];
+      p /= double(FFT_AVG) * double(FFT_N) * win_pow;
+      ch_db[c] = float(10.0 * std::log10(p + 1e-20));
+      ch_dist[c] = float(dist);
+      ch_step[c] = s;
+    }
+    if (cfg_.scan_rds) dwell[s].swap(raw);
+  }
+  dev_->close();
+
+  // noise floor: 20th percentile of channel powers (most of the raster is empty)
+  std::vector<float> sorted(ch_db);
+  std::sort(sorted.begin(), sorted.end());
+  float floor_db = sorted[sorted.size() / 5];
+
+  for (size_t c = 0; c < n_ch; ++c) {
+    float snr = ch_db[c] - floor_db;
+    if (snr < DETECT_SNR_DB) continue;
+    // report the peak of each carrier, not its neighbouring raster points
+    if (c > 0 && ch_db[c - 1] > ch_db[c]) continue;
+    if (c + 1 < n_ch && ch_db[c + 1] >= ch_db[c]) continue;
+    ScanResult r;
+    r.freq_hz = BAND_LO_HZ + double(c) * RASTER_HZ;
+    r.power_db = ch_db[c];
+    r.snr_db = snr;
+    if (cfg_.scan_rds) decode_rds(dwell[ch_step[c]], los[ch_step[c]], r);
+    out.push_back(r);
+  }
+
+  double el = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  log_msg(LogLevel::Info, "Scan: %s, %zu LO steps, %zu carriers, floor %.1f dBFS, %.2f s",
+          dev_->label().c_str(), los.size(), out.size(), floor_db, el);
+  return true;
+}
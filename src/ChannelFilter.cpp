@@ -1,20 +1,96 @@
 #include "ChannelFilter.h"
 #include "dsp/FirDesign.h"
 #include "Logging.h"
+#include <algorithm>
+#include <cmath>
 
-ChannelFilter::ChannelFilter(double fs_in, uint32_t decim, float cut_hz)
-  : fs_in_(fs_in), decim_(decim) {
+// MPX must carry RDS (59.5 kHz) and survive the channel filter cut.
+static constexpr double MPX_MIN_HZ = 176000.0;
+static constexpr double MPX_MAX_HZ = 256000.0;
+
+static constexpr int NTAPS = 161;
+static constexpr int NTAPS_LOW_COST = 61;
+
+// Offset tuning keeps the LO/DC spike at least this far from the channel.
+static constexpr double MIN_OFFSET_HZ = 250000.0;
+
+ChannelFilter::ChannelFilter(double fs_in, uint32_t decim, float cut_hz, double offset_hz)
+  : fs_in_(fs_in), decim_(decim), offset_hz_(offset_hz) {
   fs_out_ = fs_in_ / double(decim_);
-  int ntaps = 161;
-  auto taps = design_lowpass(float(fs_in_), cut_hz, ntaps);
-  decim_ = decim;
-  dec_ = FIRDecimatorC(taps, decim_);
-  log_msg(LogLevel::Info, "ChannelFilter: fs_in=%.0f Hz, decim=%u, fs_out=%.0f Hz", fs_in_, decim_, fs_out_);
+  taps_ = design_lowpass(float(fs_in_), cut_hz, NTAPS);
+  taps_lc_ = design_lowpass(float(fs_in_), cut_hz, NTAPS_LOW_COST);
+  dec_ = FIRDecimatorC(taps_, decim_);
+  dec_lc_ = FIRDecimatorC(taps_lc_, decim_);
+  if (offset_hz_ != 0.0) {
+    xl_ = FIRDecimatorXlate(taps_, decim_, fs_in_, offset_hz_);
+    xl_lc_ = FIRDecimatorXlate(taps_lc_, decim_, fs_in_, offset_hz_);
+  }
+  log_msg(LogLevel::Info, "ChannelFilter: fs_in=%.0f Hz, decim=%u, fs_out=%.0f Hz, offset=%.0f Hz",
+          fs_in_, decim_, fs_out_, offset_hz_);
+}
+
+double ChannelFilter::auto_offset(double fs_in, uint32_t decim, float cut_hz) {
+  // A multiple of the output rate makes the output counter-rotation identity.
+  double fs_out = fs_in / double(decim);
+  double off = fs_out * std::ceil(MIN_OFFSET_HZ / fs_out);
+  // keep the channel inside the captured span
+  if (off + cut_hz > 0.45 * fs_in) off = MIN_OFFSET_HZ;
+  if (off + cut_hz > 0.45 * fs_in) return 0.0;
+  return off;
+}
+
+uint32_t ChannelFilter::auto_decim(double fs_in, double fs_audio) {
+  uint32_t d_lo = std::max<uint32_t>(1, uint32_t(std::ceil(fs_in / MPX_MAX_HZ)));
+  uint32_t d_hi = std::max<uint32_t>(1, uint32_t(std::floor(fs_in / MPX_MIN_HZ)));
+  for (uint32_t d = d_hi; d >= d_lo; --d) {
+    double k = fs_in / double(d) / fs_audio;
+    if (std::fabs(k - std::round(k)) < 1e-9) return d;
+    if (d == 1) break;
+  }
+  return d_hi;
 }
 
 size_t ChannelFilter::process(const std::complex<float>* in, size_t n_in,
                               std::complex<float>* out, size_t out_cap) {
-  return dec_.process(in, n_in, out, out_cap);
+  if (offset_hz_ != 0.0) {
+    return low_cost_ ? xl_lc_.process(in, n_in, out, out_cap)
+                     : xl_.process(in, n_in, out, out_cap);
+  }
+  return low_cost_ ? dec_lc_.process(in, n_in, out, out_cap)
+                   : dec_.process(in, n_in, out, out_cap);
+}
+
+size_t ChannelFilter::process(ConstSplitIQView in, SplitIQView out) {
+  if (offset_hz_ != 0.0) {
+    return low_cost_ ? xl_lc_.process(in, out) : xl_.process(in, out);
+  }
+  return low_cost_ ? dec_lc_.process(in, out) : dec_.process(in, out);
+}
+
+void ChannelFilter::reset() {
+  dec_.reset();
+  dec_lc_.reset();
+  xl_.reset();
+  xl_lc_.reset();
+}
+
+void ChannelFilter::set_offset(double offset_hz) {
+  offset_hz_ = offset_hz;
+  if (offset_hz_ != 0.0) {
+    xl_ = FIRDecimatorXlate(taps_, decim_, fs_in_, offset_hz_);
+    xl_lc_ = FIRDecimatorXlate(taps_lc_, decim_, fs_in_, offset_hz_);
+  } else {
+    dec_.reset();
+    dec_lc_.reset();
+  }
+}
+
+void ChannelFilter::set_low_cost(bool en) {
+  if (en == low_cost_) return;
+  low_cost_ = en;
+  // the idle filter's history is stale; start it clean
+  if (low_cost_) { dec_lc_.reset(); xl_lc_.reset(); }
+  else { dec_.reset(); xl_.reset(); }
 }
 
 double ChannelFilter::fs_out() const { return fs_out_; }
@@ -0,0 +1,174 @@
+#include "ControlServer.h"
+#include "FMReceiver.h"
+#include "LatencyStats.h"
+#include "Logging.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static constexpr int EFFECT_TIMEOUT_MS = 2000;
+static constexpr size_t MAX_CLIENTS = 8;
+static constexpr size_t MAX_LINE = 256;
+
+ControlServer::ControlServer(FMReceiver& rx) : rx_(rx) {}
+
+ControlServer::~ControlServer() { stop(); }
+
+bool ControlServer::start(const std::string& path) {
+  if (running_) return false;
+  sockaddr_un a{};
+  a.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(a.sun_path)) {
+    log_msg(LogLevel::Error, "Control: bad socket path '%s'", path.c_str());
+    return false;
+  }
+  std::memcpy(a.sun_path, path.c_str(), path.size() + 1);
+
+  ::unlink(path.c_str());
+  fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd_ < 0 || ::bind(fd_, reinterpret_cast<sockaddr*>(&a), sizeof(a)) != 0 || ::listen(fd_, 4) != 0 ||
+      ::pipe2(wake_, O_CLOEXEC) != 0) {
+    log_msg(LogLevel::Error, "Control: cannot listen on %s (%s)", path.c_str(), std::strerror(errno));
+    stop();
+    return false;
+  }
+  path_ = path;
+  running_ = true;
+  th_ = std::thread(&ControlServer::worker, this);
+  log_msg(LogLevel::Info, "Control socket %s", path.c_str());
+  return true;
+}
+
+void ControlServer::stop() {
+  if (running_) {
+    running_ = false;
+    char b = 0;
+    (void)!::write(wake_[1], &b, 1);
+  }
+  if (th_.joinable()) th_.join();
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+    if (!path_.empty()) ::unlink(path_.c_str());
+    path_.clear();
+  }
+  for (int& w : wake_) {
+    if (w >= 0) ::close(w);
+    w = -1;
+  }
+}
+
+void ControlServer::worker() {
+  struct Client {
+    int fd;
+    std::string buf;
+  };
+  std::vector<Client> clients;
+  std::vector<pollfd> pfds;
+
+  while (running_) {
+    pfds.assign({{wake_[0], POLLIN, 0}, {fd_, POLLIN, 0}});
+    for (const auto& c : clients) pfds.push_back({c.fd, POLLIN, 0});
+    if (::poll(pfds.data(), pfds.size(), -1) < 0) {
+      if (errno == EINTR) continue;
+      log_msg(LogLevel::Error, "Control: poll failed (%s)", std::strerror(errno));
+      break;
+    }
+    if (pfds[0].revents) break;
+
+    if (pfds[1].revents & POLLIN) {
+      int c = ::accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (c >= 0 && clients.size() < MAX_CLIENTS) clients.push_back({c, std::string()});
+      else if (c >= 0) ::close(c);
+    }
+
+    for (size_t i = clients.size(); i-- > 0;) {
+      if (!pfds[2 + i].revents) continue;
+      Client& c = clients[i];
+      char tmp[512];
+      ssize_t n = ::read(c.fd, tmp, sizeof(tmp));
+      bool drop = n <= 0;
+      if (n > 0) c.buf.append(tmp, size_t(n));
+      size_t eol;
+      while (!drop && (eol = c.buf.find('\n')) != std::string::npos) {
+        std::string reply = handle(c.buf.substr(0, eol)) + "\n";
+        c.buf.erase(0, eol + 1);
+        drop = ::send(c.fd, reply.data(), reply.size(), MSG_NOSIGNAL) != ssize_t(reply.size());
+      }
+      if (c.buf.size() > MAX_LINE) drop = true;
+      if (drop) {
+        ::close(c.fd);
+        clients.erase(clients.begin() + long(i));
+      }
+    }
+  }
+  for (const auto& c : clients) ::close(c.fd);
+}
+
+std::string ControlServer::handle(const std::string& line) {
+  char cmd[16] = {0}, arg[64] = {0};
+  int fields = std::sscanf(line.c_str(), "%15s %63s", cmd, arg);
+  if (fields < 1) return "err empty command";
+  commands_++;
+  char out[160];
+
+  if (!std::strcmp(cmd, "status")) {
+    ReceiverConfig s = rx_.settings();
+    std::string ps = rx_.program_service();
+    std::snprintf(out, sizeof(out), "ok freq %.3f lna %u vga %u gain %.2f rds %s ps %s",
+                  s.rf_freq_hz / 1e6, s.lna_gain_db, s.vga_gain_db, rx_.audio_gain(),
+                  s.enable_rds ? "on" : "off", ps.empty() ? "-" : ps.c_str());
+    return out;
+  }
+  if (fields < 2) return std::string("err ") + cmd + " needs a value";
+
+  char* end = nullptr;
+  double v = std::strtod(arg, &end);
+  // strtod also takes "nan" and "inf", which every range check below lets through
+  bool num = end != arg && *end == '\0' && std::isfinite(v);
+  bool whole = num && v == std::floor(v);
+  bool rds_stage = false;
+  uint64_t t0 = mono_ns();
+  if (!std::strcmp(cmd, "freq")) {
+    // only the band is checked here; a device failure is reported below
+    if (!num || !rx_.set_frequency_mhz(v)) return "err freq out of range (87.5..108 MHz)";
+  } else if (!std::strcmp(cmd, "lna")) {
+    if (!whole || v < 0 || v > 40 || int(v) % 8 != 0 || !rx_.set_lna_gain_db(uint32_t(v)))
+      return "err lna must be 0..40 dB in steps of 8";
+  } else if (!std::strcmp(cmd, "vga")) {
+    if (!whole || v < 0 || v > 62 || int(v) % 2 != 0 || !rx_.set_vga_gain_db(uint32_t(v)))
+      return "err vga must be 0..62 dB in steps of 2";
+  } else if (!std::strcmp(cmd, "gain")) {
+    if (!num || v < 0.0 || v > 10.0) return "err gain must be 0..10";
+    rx_.set_audio_gain(float(v));
+  } else if (!std::strcmp(cmd, "rds")) {
+    bool on = !std::strcmp(arg, "on");
+    if (!on && std::strcmp(arg, "off")) return "err rds on|off";
+    rx_.set_rds_enabled(on);
+    rds_stage = true;
+  } else {
+    return std::string("err unknown command '") + cmd + "'";
+  }
+
+  // time to effect: until the first chunk carrying the change leaves the
+  // pipeline (block boundary wait plus the pipeline's latency)
+  ControlResult r = rx_.wait_control(rx_.last_control(), rds_stage, EFFECT_TIMEOUT_MS);
+  double ms = double(mono_ns() - t0) / 1e6;
+  if (r == ControlResult::Failed) {
+    log_msg(LogLevel::Warn, "Control: %s %s rejected by the device", cmd, arg);
+    std::snprintf(out, sizeof(out), "err %s: device rejected the change", cmd);
+    return out;
+  }
+  bool seen = r == ControlResult::Applied;
+  log_msg(LogLevel::Info, "Control: %s %s (%.1f ms%s)", cmd, arg, ms, seen ? "" : ", not observed");
+  if (seen) std::snprintf(out, sizeof(out), "ok %s %.1f ms", cmd, ms);
+  else std::snprintf(out, sizeof(out), "ok %s applied, not observed in %.0f ms", cmd, ms);
+  return out;
+}
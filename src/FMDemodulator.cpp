@@ -1,6 +1,21 @@
 #include "FMDemodulator.h"
+#include <algorithm>
 #include <cmath>
 
+static inline float fast_atan2(float y, float x) {
+  // atan on [0,1] by minimax polynomial, then fold octants back. Written
+  // without branches so loops over it vectorize.
+  const float ax = std::fabs(x), ay = std::fabs(y);
+  const float mx = std::max(ax, ay), mn = std::min(ax, ay);
+  const float z = mn / std::max(mx, 1e-30f);
+  const float z2 = z * z;
+  float a = z * (0.99997726f + z2 * (-0.33262347f + z2 * (0.19354346f +
+            z2 * (-0.11643287f + z2 * (0.05265332f - 0.01172120f * z2)))));
+  a += float(ay > ax) * (float(M_PI / 2.0) - 2.0f * a);
+  a += float(x < 0.0f) * (float(M_PI) - 2.0f * a);
+  return std::copysign(a, y);
+}
+
 FMDemodulator::FMDemodulator() { reset(); }
 
 void FMDemodulator::reset() {
@@ -22,8 +37,43 @@ size_t FMDemodulator::process(const std::complex<float>* in, size_t n_in,
     // Quadrature discriminator: angle(conj(prev)*x)
     float re = (prev_.real() * x.real()) + (prev_.imag() * x.imag());
     float im = (prev_.real() * x.imag()) - (prev_.imag() * x.real());
-    out[i] = std::atan2(im, re);
+    out[i] = fast_ ? fast_atan2(im, re) : std::atan2(im, re);
     prev_ = x;
   }
   return n;
 }
+
+size_t FMDemodulator::process(ConstSplitIQView in, float* out, size_t out_cap) {
+  size_t n = std::min(in.n, out_cap);
+  if (n == 0) return 0;
+  if (re_.size() < n) { re_.resize(n); im_.resize(n); }
+
+  size_t start = 0;
+  if (!have_prev_) {
+    out[0] = 0.0f;
+    have_prev_ = true;
+    start = 1;
+  } else {
+    float pi = prev_.real(), pq = prev_.imag();
+    re_[0] = pi * in.i[0] + pq * in.q[0];
+    im_[0] = pi * in.q[0] - pq * in.i[0];
+  }
+  // conj(x[k-1]) * x[k] for the rest of the block
+  const float* xi = in.i;
+  const float* xq = in.q;
+  float* re = re_.data();
+  float* im = im_.data();
+#pragma omp simd
+  for (size_t k = 1; k < n; ++k) {
+    re[k] = xi[k-1] * xi[k] + xq[k-1] * xq[k];
+    im[k] = xi[k-1] * xq[k] - xq[k-1] * xi[k];
+  }
+  if (fast_) {
+#pragma omp simd
+    for (size_t k = start; k < n; ++k) out[k] = fast_atan2(im[k], re[k]);
+  } else {
+    for (size_t k = start; k < n; ++k) out[k] = std::atan2(im[k], re[k]);
+  }
+  prev_ = {in.i[n-1], in.q[n-1]};
+  return n;
+}
@@ -1,139 +1,519 @@
 #include "FMReceiver.h"
 #include "Logging.h"
+#include "dsp/IQConvert.h"
+#include "RealTime.h"
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 
-FMReceiver::FMReceiver(const ReceiverConfig& cfg, AudioRingBuffer& audio_out)
+static constexpr size_t MPX_TAP_DEPTH = 16;
+static constexpr size_t SPECTRUM_TAP_DEPTH = 2;
+
+static uint32_t rf_decim_for(const ReceiverConfig& cfg) {
+  return cfg.rf_decim ? cfg.rf_decim : ChannelFilter::auto_decim(cfg.sample_rate_hz, cfg.audio_rate_hz);
+}
+
+static double offset_for(const ReceiverConfig& cfg) {
+  if (!cfg.offset_tune) return 0.0;
+  if (cfg.tune_offset_hz != 0.0) return cfg.tune_offset_hz;
+  return ChannelFilter::auto_offset(cfg.sample_rate_hz, rf_decim_for(cfg), cfg.channel_cut_hz);
+}
+
+FMReceiver::FMReceiver(const ReceiverConfig& cfg, AudioBroadcast& audio_out)
   : cfg_(cfg),
     audio_out_(audio_out),
-    chan_(cfg.sample_rate_hz, cfg.rf_decim, cfg.channel_cut_hz),
-    audio_(chan_.fs_out(), cfg.audio_decim, cfg.deemph_tau_s, cfg.audio_cut_hz),
-    rds_(chan_.fs_out()) {
+    dev_(make_iq_source(cfg.device, cfg)),
+    chan_(cfg.sample_rate_hz, rf_decim_for(cfg), cfg.channel_cut_hz, offset_for(cfg)),
+    audio_(chan_.fs_out(), cfg.audio_rate_hz, cfg.deemph_tau_s, cfg.audio_cut_hz),
+    rds_(chan_.fs_out()),
+    sq_(cfg.squelch_db, cfg.squelch_hyst_db, cfg.squelch_hang_s) {
 
-  q_.resize(size_t(cfg_.sample_rate_hz / 10) * 2); // about 0.1s of IQ bytes
+  if (cfg_.stereo) {
+    stereo_.reset(new StereoDecoder(chan_.fs_out(), cfg.audio_rate_hz, cfg.deemph_tau_s, cfg.audio_cut_hz));
+  }
+  rds_.set_auto(cfg_.rds_auto);
+
+  // The IQ ring and the chunk being converted live in one arena, placed
+  // on the source thread's NUMA node when it is pinned.
+  size_t q_bytes = std::max(size_t(cfg_.sample_rate_hz / 10) * 2, // about 0.1s of IQ bytes
+                            size_t(cfg_.block_bytes) * 4);
+  size_t raw_bytes = bytes_per_chunk();
+  int node = numa_node_of_cpu(cfg_.cpu_dsp.empty() ? cfg_.cpu_usb : cfg_.cpu_dsp[0]);
+  if (arena_.reserve(q_bytes + raw_bytes + SIMD_ALIGN, cfg_.huge_pages, node, "IQ arena")) {
+    q_ = arena_.alloc_array<uint8_t>(q_bytes);
+    q_cap_ = q_bytes;
+    raw_ = arena_.alloc_array<uint8_t>(raw_bytes);
+    raw_cap_ = raw_bytes;
+  }
 }
 
 FMReceiver::~FMReceiver() { stop(); }
 
 bool FMReceiver::start() {
   if (running_) return true;
-  if (!dev_.open()) return false;
+  if (!q_ || !raw_) return false;
+  if (!dev_->open()) return false;
 
-  if (!dev_.configure(cfg_.rf_freq_hz, cfg_.sample_rate_hz, cfg_.lna_gain_db, cfg_.vga_gain_db)) return false;
+  // Offset tuning: the LO sits below the station so its DC spike is outside the channel.
+  {
+    std::lock_guard<std::mutex> lock(tune_m_);
+    lo_hz_ = cfg_.rf_freq_hz - chan_.offset_hz();
+    tune_pending_ = false;
+    hw_pending_ = false;
+    pending_lna_ = pending_vga_ = -1;
+    rds_on_ = cfg_.enable_rds;
+  }
+  if (!dev_->configure(lo_hz_, cfg_.sample_rate_hz, cfg_.lna_gain_db, cfg_.vga_gain_db)) return false;
 
-  rds_.set_enabled(cfg_.enable_rds);
+  // switched per chunk by the RDS block (ChunkTag::rds)
+  rds_.set_enabled(true);
+  sq_.reset();
 
   q_stop_ = false;
   q_r_ = q_w_ = q_size_ = 0;
+  q_marks_.clear();
+  q_w_total_ = q_r_total_ = 0;
+
+  epoch_ = 0;
+  cur_offset_ = chan_.offset_hz();
+  seen_overruns_ = q_overruns_;
+  if (!open_outputs()) return false;
+  build_graph();
 
   running_ = true;
-  th_ = std::thread(&FMReceiver::worker, this);
+  usb_policy_done_ = false;
+  graph_->start(cfg_.graph_threads);
 
-  bool ok = dev_.start_rx([this](const uint8_t* iq, size_t bytes){ on_hackrf_iq(iq, bytes); });
+  bool ok = dev_->start_rx([this](const uint8_t* iq, size_t bytes){ on_hackrf_iq(iq, bytes); });
   if (!ok) {
     running_ = false;
     q_stop_ = true;
     cv_.notify_all();
-    if (th_.joinable()) th_.join();
+    graph_->wait();
+    close_outputs();
     return false;
   }
 
-  log_msg(LogLevel::Info, "RX started at %.3f MHz", cfg_.rf_freq_hz / 1e6);
+  faults_at_start_ = page_faults();
+  log_msg(LogLevel::Info, "RX %s started at %.3f MHz, block %u bytes (%.2f ms)",
+          dev_->label().c_str(), cfg_.rf_freq_hz / 1e6, cfg_.block_bytes,
+          1000.0 * double(cfg_.block_bytes / 2) / cfg_.sample_rate_hz);
+  if (cfg_.block_bytes < USB_TRANSFER_BYTES)
+    log_msg(LogLevel::Info, "RX %s: IQ still comes in %zu KB USB transfers of %.2f ms, not counted in the "
+            "latency stats (they start at the transfer callback)", dev_->label().c_str(), USB_TRANSFER_BYTES / 1024,
+            1000.0 * double(USB_TRANSFER_BYTES / 2) / cfg_.sample_rate_hz);
   return true;
 }
 
+bool FMReceiver::open_outputs() {
+  bool ok = true;
+  if (!cfg_.mpx_path.empty()) {
+    ok = mpx_.open(cfg_.mpx_path, chan_.fs_out(), cfg_.rf_freq_hz,
+                   cfg_.mpx_f16 ? MpxFormat::Float16 : MpxFormat::Int16);
+  }
+  if (ok && !cfg_.rds_archive_dir.empty()) {
+    ok = archive_.open(cfg_.rds_archive_dir);
+    // labelled with the tuning of the chunk that completed the group
+    rds_.set_group_callback([this](const RdsGroup& g) {
+      const ChunkTag& t = rds_blk_->tag();
+      archive_.append(g, rds_now_us(), t.lo_hz + t.offset_hz);
+    });
+  }
+
+  SpectrumSettings ss;
+  ss.fft_n = cfg_.spectrum_fft;
+  ss.rate_hz = cfg_.spectrum_rate_hz;
+  ss.avg = cfg_.spectrum_avg;
+  ss.budget = cfg_.spectrum_budget;
+  spec_iq_.reset();
+  spec_ch_.reset();
+  if (ok && !cfg_.spectrum_iq.empty()) {
+    spec_iq_.reset(new SpectrumMonitor(SpectrumSource::Wideband, cfg_.sample_rate_hz, ss));
+    ok = spec_iq_->open(cfg_.spectrum_iq);
+  }
+  if (ok && !cfg_.spectrum_ch.empty()) {
+    spec_ch_.reset(new SpectrumMonitor(SpectrumSource::Channel, chan_.fs_out(), ss));
+    ok = spec_ch_->open(cfg_.spectrum_ch);
+  }
+
+  if (!ok) close_outputs();
+  return ok;
+}
+
+void FMReceiver::close_outputs() {
+  mpx_.close();
+  archive_.close();
+  rds_.set_group_callback(nullptr);
+  if (spec_iq_) spec_iq_->close();
+  if (spec_ch_) spec_ch_->close();
+}
+
 void FMReceiver::stop() {
   if (!running_) return;
-  dev_.stop_rx();
+  dev_->stop_rx();
   {
     std::lock_guard<std::mutex> lock(m_);
     q_stop_ = true;
   }
   cv_.notify_all();
-  if (th_.joinable()) th_.join();
-  dev_.close();
+  // the source ends the stream; queued chunks drain through the graph
+  graph_->wait();
+  if (mpx_tap_) mpx_tap_->pad_to(chan_blk_->samples_out());
+  if (mpx_tap_ && mpx_tap_->in.dropped()) {
+    log_msg(LogLevel::Warn, "MPX capture: %llu chunks (%.2f s) dropped by a slow disk, written as gaps",
+            (unsigned long long)mpx_tap_->in.dropped(), double(mpx_tap_->gap_samples()) / chan_.fs_out());
+  }
+  close_outputs();
+  dev_->close();
   running_ = false;
 }
 
+double FMReceiver::max_digital_offset() const {
+  double half_span = std::min(0.45 * cfg_.sample_rate_hz, 0.5 * double(dev_->baseband_bw_hz()));
+  return half_span - double(cfg_.channel_cut_hz);
+}
+
 bool FMReceiver::set_frequency_mhz(double mhz) {
   double hz = mhz * 1e6;
-  if (mhz < 87.5 || mhz > 108.0) return false;
+  if (!(mhz >= 87.5 && mhz <= 108.0)) return false;   // NaN too
+
+  std::lock_guard<std::mutex> lock(tune_m_);
   cfg_.rf_freq_hz = hz;
-  return dev_.set_frequency(hz);
+  tune_seq_ = ++ctl_seq_;
+  // start() tunes the device from cfg_
+  if (!running_) return true;
+  // relative to the LO a hardware retune still pending will set
+  double off = hz - (hw_pending_ ? hw_lo_hz_ : lo_hz_);
+
+  // With offset tuning the channel must also stay clear of the LO spike.
+  double min_off = cfg_.offset_tune ? double(cfg_.channel_cut_hz) : 0.0;
+  if (std::fabs(off) <= max_digital_offset() && std::fabs(off) >= min_off) {
+    // a hardware retune may still be discarding IQ from the old LO; that
+    // discard stands, so tune_discard_until_ is left as it is
+    tune_offset_ = off;
+    tune_pending_ = true;
+    retunes_digital_++;
+    log_msg(LogLevel::Info, "Retune %.3f MHz in DSP (offset %+.0f Hz)", mhz, off);
+    return true;
+  }
+
+  // The source thread moves the LO at its next block boundary
+  // (apply_hw_tune), so the device is only ever driven from one thread.
+  double default_off = offset_for(cfg_);
+  hw_lo_hz_ = hz - default_off;
+  hw_pending_ = true;
+  tune_offset_ = default_off;
+  tune_pending_ = true;
+  return true;
 }
 
-bool FMReceiver::set_lna_gain_db(uint32_t db) { cfg_.lna_gain_db = db; return dev_.set_lna_gain(db); }
-bool FMReceiver::set_vga_gain_db(uint32_t db) { cfg_.vga_gain_db = db; return dev_.set_vga_gain(db); }
-void FMReceiver::set_audio_gain(float g) { audio_.set_audio_gain(g); }
+void FMReceiver::apply_hw_tune() {
+  hw_pending_ = false;
+  if (!dev_->set_frequency(hw_lo_hz_)) {
+    // keep receiving the old station and say so to wait_control()
+    log_msg(LogLevel::Error, "Retune to LO %.3f MHz failed, staying on %.3f MHz", hw_lo_hz_ / 1e6,
+            (lo_hz_ + cur_offset_) / 1e6);
+    cfg_.rf_freq_hz = lo_hz_ + cur_offset_;
+    tune_pending_ = false;
+    ctl_failed_ = tune_seq_;
+    return;
+  }
+  lo_hz_ = hw_lo_hz_;
+  // Everything queued or still in USB flight belongs to the old tuning;
+  // allow one transfer plus PLL settling before trusting samples again.
+  uint64_t margin = USB_TRANSFER_BYTES + uint64_t(cfg_.sample_rate_hz * 2.0 * 0.002);
+  {
+    std::lock_guard<std::mutex> qlock(m_);
+    tune_discard_until_ = q_w_total_ + margin;
+  }
+  retunes_hw_++;
+  log_msg(LogLevel::Info, "Retune %.3f MHz via hardware (LO %.3f MHz)", cfg_.rf_freq_hz / 1e6, lo_hz_ / 1e6);
+}
+
+bool FMReceiver::set_lna_gain_db(uint32_t db) {
+  std::lock_guard<std::mutex> lock(tune_m_);
+  cfg_.lna_gain_db = db;
+  lna_seq_ = ++ctl_seq_;
+  if (!running_) return dev_->set_lna_gain(db);
+  pending_lna_ = int(db);
+  return true;
+}
+
+bool FMReceiver::set_vga_gain_db(uint32_t db) {
+  std::lock_guard<std::mutex> lock(tune_m_);
+  cfg_.vga_gain_db = db;
+  vga_seq_ = ++ctl_seq_;
+  if (!running_) return dev_->set_vga_gain(db);
+  pending_vga_ = int(db);
+  return true;
+}
+
+void FMReceiver::set_audio_gain(float g) {
+  std::lock_guard<std::mutex> lock(tune_m_);
+  audio_gain_ = g;
+  ctl_seq_++;
+  if (!running_) {
+    audio_.set_audio_gain(g);
+    if (stereo_) stereo_->set_audio_gain(g);
+  }
+}
+
+void FMReceiver::set_rds_enabled(bool on) {
+  std::lock_guard<std::mutex> lock(tune_m_);
+  cfg_.enable_rds = on;
+  rds_on_ = on;
+  ctl_seq_++;
+}
+
+uint32_t FMReceiver::last_control() const {
+  std::lock_guard<std::mutex> lock(tune_m_);
+  return ctl_seq_;
+}
+
+ControlResult FMReceiver::wait_control(uint32_t seq, bool rds_stage, int timeout_ms) const {
+  uint64_t deadline = mono_ns() + uint64_t(std::max(0, timeout_ms)) * 1000000ull;
+  while (running_) {
+    // set before any chunk reflecting seq leaves the source
+    if (ctl_failed_ == seq) return ControlResult::Failed;
+    uint32_t seen = rds_stage ? rds_blk_->ctl_seen() : sink_blk_->ctl_seen();
+    if (int32_t(seen - seq) >= 0) return ControlResult::Applied;
+    if (mono_ns() >= deadline) return ControlResult::Timeout;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return ControlResult::Timeout;
+}
+
+ReceiverConfig FMReceiver::settings() const {
+  std::lock_guard<std::mutex> lock(tune_m_);
+  return cfg_;
+}
+
+float FMReceiver::audio_gain() const {
+  std::lock_guard<std::mutex> lock(tune_m_);
+  return audio_gain_;
+}
+
+long FMReceiver::page_faults_streaming() const { return page_faults() - faults_at_start_; }
 
 std::string FMReceiver::program_service() const { return rds_.program_service(); }
 
 void FMReceiver::on_hackrf_iq(const uint8_t* iq, size_t bytes) {
-  q_push(iq, bytes);
+  if (!usb_policy_done_) {
+    // first callback runs on libhackrf's transfer thread
+    usb_policy_done_ = true;
+    ThreadPolicy p;
+    p.cpu = cfg_.cpu_usb;
+    p.fifo_prio = cfg_.rt_prio > 0 ? std::min(cfg_.rt_prio + 1, 99) : 0;
+    if (!p.empty()) apply_thread_policy("usb", p);
+  }
+  q_push(iq, bytes, mono_ns());
 }
 
-void FMReceiver::q_push(const uint8_t* p, size_t n) {
+void FMReceiver::q_push(const uint8_t* p, size_t n, uint64_t t_ns) {
   std::unique_lock<std::mutex> lock(m_);
   if (q_stop_) return;
 
+  if (q_size_ + n > q_cap_) q_overruns_++;
   for (size_t i = 0; i < n; ++i) {
-    if (q_size_ == q_.size()) {
-      q_r_ = (q_r_ + 1) % q_.size();
+    if (q_size_ == q_cap_) {
+      q_r_ = (q_r_ + 1) % q_cap_;
       --q_size_;
+      ++q_r_total_;
     }
     q_[q_w_] = p[i];
-    q_w_ = (q_w_ + 1) % q_.size();
+    q_w_ = (q_w_ + 1) % q_cap_;
     ++q_size_;
   }
+  q_w_total_ += n;
+  if (q_marks_.size() == 1024) q_marks_.pop_front();
+  q_marks_.emplace_back(q_w_total_, t_ns);
   cv_.notify_one();
 }
 
-size_t FMReceiver::q_pop(uint8_t* out, size_t nmax) {
+size_t FMReceiver::q_pop(uint8_t* out, size_t nmax, uint64_t& t_ns, uint64_t& seq_end) {
   std::unique_lock<std::mutex> lock(m_);
   cv_.wait(lock, [&]{ return q_stop_ || q_size_ >= nmax; });
+  t_ns = 0;
   if (q_stop_) return 0;
 
   size_t n = nmax;
   for (size_t i = 0; i < n; ++i) {
     out[i] = q_[q_r_];
-    q_r_ = (q_r_ + 1) % q_.size();
+    q_r_ = (q_r_ + 1) % q_cap_;
   }
   q_size_ -= n;
+  q_r_total_ += n;
+  seq_end = q_r_total_;
+
+  // Tag the block with the callback time of the transfer holding its last byte.
+  while (!q_marks_.empty() && q_marks_.front().first < q_r_total_) q_marks_.pop_front();
+  if (!q_marks_.empty()) t_ns = q_marks_.front().second;
   return n;
 }
 
-void FMReceiver::worker() {
-  // Work in chunks aligned to HackRF USB transfers.
-  const size_t bytes_per_chunk = 262144; // 256 KB
-  std::vector<uint8_t> raw(bytes_per_chunk);
+void FMReceiver::build_graph() {
+  graph_.reset(new FlowGraph());
+  block_s_ = double(bytes_per_chunk() / 2) / cfg_.sample_rate_hz;
+  src_ = graph_->add<SourceBlock<SplitIQBuffer>>("iq", [this](Chunk<SplitIQBuffer>& c){ return fill_iq(c); });
+  chan_blk_ = graph_->add<ChannelFilterBlock>(chan_, cfg_.squelch ? &sq_ : nullptr, block_s_);
+  auto* demod = graph_->add<FMDemodBlock>(demod_);
+  auto* rds = graph_->add<RDSBlock>(rds_);
+  rds_blk_ = rds;
+  auto* audio = graph_->add<AudioBlock>(audio_, stereo_.get(), chan_.fs_out(), cfg_.audio_rate_hz,
+                                        cfg_.squelch_silence);
+  auto* sink = graph_->add<AudioRingSinkBlock>(audio_out_);
+  sink_blk_ = sink;
+
+  graph_->connect(src_->out, chan_blk_->in);
+  graph_->connect(chan_blk_->out, demod->in);
+  // RDS and audio read the same MPX chunks (on their own threads with --graph-threads)
+  graph_->connect(demod->out, rds->in);
+  graph_->connect(demod->out, audio->in);
+  graph_->connect(audio->out, sink->in);
+  mpx_tap_ = nullptr;
+  if (mpx_.is_open()) {
+    // deep queue: a slow disk write loses chunks only once it is full
+    mpx_tap_ = graph_->add<MpxTapBlock>(mpx_);
+    graph_->connect_lossy(demod->out, mpx_tap_->in, MPX_TAP_DEPTH);
+  }
+  // Spectrum taps see the same chunks as the channel filter and the demod,
+  // but only those they keep up with.
+  auto center = [](const ChunkTag& t, bool channel) {
+    return t.lo_hz + (channel ? t.offset_hz : 0.0);
+  };
+  if (spec_iq_) {
+    auto* tap = graph_->add<SpectrumTapBlock>("spectrum-iq", *spec_iq_,
+                                              [center](const ChunkTag& t){ return center(t, false); });
+    graph_->connect_lossy(src_->out, tap->in, SPECTRUM_TAP_DEPTH);
+  }
+  if (spec_ch_) {
+    auto* tap = graph_->add<SpectrumTapBlock>("spectrum-ch", *spec_ch_,
+                                              [center](const ChunkTag& t){ return center(t, true); });
+    graph_->connect_lossy(chan_blk_->out, tap->in, SPECTRUM_TAP_DEPTH);
+  }
+  last_busy_.assign(graph_->blocks().size(), 0);
+
+  if (!cfg_.cpu_dsp.empty() || cfg_.rt_prio > 0) {
+    const auto& blocks = graph_->blocks();
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      ThreadPolicy p;
+      if (!cfg_.cpu_dsp.empty()) p.cpu = cfg_.cpu_dsp[i % cfg_.cpu_dsp.size()];
+      // monitors stay SCHED_OTHER: under load they lose chunks, not the DSP threads
+      p.fifo_prio = blocks[i]->monitor() ? 0 : cfg_.rt_prio;
+      blocks[i]->set_thread_policy(p);
+    }
+  }
 
-  // Convert to complex float
-  std::vector<std::complex<float>> iqf(bytes_per_chunk / 2);
+  if (cfg_.prefault) {
+    // Chunks in flight: each queue (depth 4) plus one held per reader and
+    // one being written; the MPX port also feeds the capture tap, and the
+    // IQ and channel ports the spectrum taps, if any.
+    const size_t pool = 2 * (4 + 1) + 1;
+    const size_t mpx_pool = pool + (mpx_.is_open() ? MPX_TAP_DEPTH + 1 : 0);
+    const size_t iq_pool = pool + (spec_iq_ ? SPECTRUM_TAP_DEPTH + 1 : 0);
+    const size_t ch_pool = pool + (spec_ch_ ? SPECTRUM_TAP_DEPTH + 1 : 0);
+    const size_t n_iq = bytes_per_chunk() / 2;
+    const size_t n_ch = n_iq / chan_.decim() + 8;
+    const size_t n_pcm = 2 * (size_t(double(n_ch) * cfg_.audio_rate_hz / chan_.fs_out()) + 8);
+    src_->out.prime(iq_pool, [&](SplitIQBuffer& b){ b.resize(n_iq); });
+    chan_blk_->out.prime(ch_pool, [&](SplitIQBuffer& b){ b.resize(n_ch); });
+    demod->out.prime(mpx_pool, [&](AlignedFloats& v){ v.resize(n_ch); });
+    audio->out.prime(pool, [&](AlignedVector<int16_t>& v){ v.resize(n_pcm); });
+    prefault(q_, q_cap_);
+    warm_up(n_iq);
+  }
+}
 
-  // After RF decim, size reduces by rf_decim
-  size_t max_decim_out = iqf.size() / cfg_.rf_decim + 8;
-  std::vector<std::complex<float>> iqc(max_decim_out);
+void FMReceiver::warm_up(size_t n_iq) {
+  // One block of silence through every stage sizes their scratch buffers
+  // now rather than on the first live block; then start them clean.
+  SplitIQBuffer iq(n_iq), ch(n_iq / chan_.decim() + 8);
+  std::vector<float> mpx(ch.size());
+  std::vector<int16_t> pcm(2 * ch.size());
+  size_t n_c = chan_.process(iq.cview(n_iq), ch.view());
+  size_t n_m = demod_.process(ch.cview(n_c), mpx.data(), mpx.size());
+  rds_.process(mpx.data(), n_m);
+  audio_.process(mpx.data(), n_m, pcm.data(), pcm.size());
+  if (stereo_) stereo_->process(mpx.data(), n_m, pcm.data(), ch.size());
+  chan_.reset();
+  demod_.reset();
+  rds_.reset();
+  audio_.reset();
+  if (stereo_) stereo_->reset();
+}
 
-  std::vector<float> mpx(max_decim_out);
-  std::vector<int16_t> pcm(max_decim_out);
+size_t FMReceiver::bytes_per_chunk() const {
+  // Default chunk matches a HackRF USB transfer; low-latency mode uses less.
+  return std::max<size_t>(2, cfg_.block_bytes & ~size_t(1));
+}
 
+bool FMReceiver::fill_iq(Chunk<SplitIQBuffer>& c) {
+  uint64_t t_ns = 0, seq_end = 0;
+  size_t got = 0;
   while (true) {
-    size_t got = q_pop(raw.data(), bytes_per_chunk);
-    if (got == 0) break;
-
-    size_t n_iq = got / 2;
-    for (size_t i = 0; i < n_iq; ++i) {
-      float I = (float(raw[2*i]) - 127.5f) / 128.0f;
-      float Q = (float(raw[2*i + 1]) - 127.5f) / 128.0f;
-      iqf[i] = {I, Q};
-    }
+    uint64_t t_wait = mono_ns();
+    got = q_pop(raw_, raw_cap_, t_ns, seq_end);
+    src_->note_wait(mono_ns() - t_wait);
+    if (got == 0) return false;
 
-    size_t n_c = chan_.process(iqf.data(), n_iq, iqc.data(), iqc.size());
-    size_t n_m = demod_.process(iqc.data(), n_c, mpx.data(), mpx.size());
+    std::lock_guard<std::mutex> lock(tune_m_);
+    if (hw_pending_) apply_hw_tune();
+    if (!tune_pending_) break;
+    if (seq_end <= tune_discard_until_) continue;  // stale IQ from before a hardware retune
+    // blocks downstream pick this up from the tag at this exact chunk
+    epoch_++;
+    cur_offset_ = tune_offset_;
+    tune_pending_ = false;
+    break;
+  }
 
-    if (cfg_.enable_rds) rds_.process(mpx.data(), n_m);
+  {
+    // live control: hardware gains from here on, the rest rides the tag
+    std::lock_guard<std::mutex> lock(tune_m_);
+    if (pending_lna_ >= 0 && !dev_->set_lna_gain(uint32_t(pending_lna_))) {
+      log_msg(LogLevel::Error, "LNA gain %d dB failed", pending_lna_);
+      ctl_failed_ = lna_seq_;
+    }
+    if (pending_vga_ >= 0 && !dev_->set_vga_gain(uint32_t(pending_vga_))) {
+      log_msg(LogLevel::Error, "VGA gain %d dB failed", pending_vga_);
+      ctl_failed_ = vga_seq_;
+    }
+    pending_lna_ = pending_vga_ = -1;
+    c.tag.audio_gain = audio_gain_;
+    c.tag.rds = rds_on_;
+    c.tag.lo_hz = lo_hz_;
+    // a retune still waiting out stale IQ is not reflected yet
+    c.tag.ctl = tune_pending_ ? tune_seq_ - 1 : ctl_seq_;
+  }
 
-    size_t n_pcm = audio_.process(mpx.data(), n_m, pcm.data(), pcm.size());
-    if (n_pcm > 0) audio_out_.push(pcm.data(), n_pcm);
+  size_t n_iq = got / 2;
+  if (c.data.size() < n_iq) c.data.resize(n_iq);
+  iq_s8_to_split(raw_, n_iq, c.data.view());
+  c.n = n_iq;
+
+  if (cfg_.auto_degrade) {
+    // Threaded, the busiest stage bounds throughput; serial, all of them
+    // together. Monitors drop chunks instead and are left out.
+    uint64_t worst = 0;
+    const auto& blocks = graph_->blocks();
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      uint64_t b = blocks[i]->busy_ns();
+      uint64_t d = b - last_busy_[i];
+      last_busy_[i] = b;
+      if (blocks[i]->monitor()) continue;
+      worst = cfg_.graph_threads ? std::max(worst, d) : worst + d;
+    }
+    uint64_t ov = q_overruns_;
+    bool overrun = ov != seen_overruns_;
+    seen_overruns_ = ov;
+    gov_.update(double(worst) * 1e-9, block_s_, overrun);
+    tier_ = gov_.tier();
+    rtf_ = gov_.rtf();
   }
+
+  c.tag.t_ns = t_ns;
+  c.tag.epoch = epoch_;
+  c.tag.tier = gov_.tier();
+  c.tag.offset_hz = cur_offset_;
+  return true;
 }
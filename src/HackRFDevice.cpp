@@ -1,25 +1,57 @@
 #include "HackRFDevice.h"
 #include "Logging.h"
 
+static std::mutex g_lib_m;
+static int g_lib_refs = 0;
+
+bool HackRFDevice::lib_acquire() {
+  std::lock_guard<std::mutex> lock(g_lib_m);
+  if (g_lib_refs == 0) {
+    int r = hackrf_init();
+    if (r != HACKRF_SUCCESS) {
+      log_msg(LogLevel::Error, "hackrf_init failed: %s", hackrf_error_name((hackrf_error)r));
+      return false;
+    }
+  }
+  g_lib_refs++;
+  return true;
+}
+
+void HackRFDevice::lib_release() {
+  std::lock_guard<std::mutex> lock(g_lib_m);
+  if (g_lib_refs > 0 && --g_lib_refs == 0) hackrf_exit();
+}
+
+std::vector<std::string> HackRFDevice::list_serials() {
+  std::vector<std::string> out;
+  if (!lib_acquire()) return out;
+  if (hackrf_device_list_t* list = hackrf_device_list()) {
+    for (int i = 0; i < list->devicecount; ++i) {
+      if (list->serial_numbers[i]) out.push_back(list->serial_numbers[i]);
+    }
+    hackrf_device_list_free(list);
+  }
+  lib_release();
+  return out;
+}
+
 HackRFDevice::~HackRFDevice() { close(); }
 
 bool HackRFDevice::open() {
   if (dev_) return true;
+  if (!lib_acquire()) return false;
+  lib_held_ = true;
 
-  int r = hackrf_init();
-  if (r != HACKRF_SUCCESS) {
-    log_msg(LogLevel::Error, "hackrf_init failed: %s", hackrf_error_name((hackrf_error)r));
-    return false;
-  }
-
-  r = hackrf_open(&dev_);
+  int r = serial_.empty() ? hackrf_open(&dev_) : hackrf_open_by_serial(serial_.c_str(), &dev_);
   if (r != HACKRF_SUCCESS || !dev_) {
-    log_msg(LogLevel::Error, "hackrf_open failed: %s", hackrf_error_name((hackrf_error)r));
-    hackrf_exit();
+    log_msg(LogLevel::Error, "hackrf_open %s failed: %s", serial_.empty() ? "(first)" : serial_.c_str(),
+            hackrf_error_name((hackrf_error)r));
     dev_ = nullptr;
+    lib_held_ = false;
+    lib_release();
     return false;
   }
-  log_msg(LogLevel::Info, "HackRF opened");
+  log_msg(LogLevel::Info, "HackRF opened %s", serial_.empty() ? "(first)" : serial_.c_str());
   return true;
 }
 
@@ -29,7 +61,10 @@ void HackRFDevice::close() {
     hackrf_close(dev_);
     dev_ = nullptr;
   }
-  hackrf_exit();
+  if (lib_held_) {
+    lib_held_ = false;
+    lib_release();
+  }
 }
 
 bool HackRFDevice::configure(double freq_hz, double sample_rate_hz, uint32_t lna_gain_db, uint32_t vga_gain_db) {
@@ -51,7 +86,7 @@ bool HackRFDevice::configure(double freq_hz, double sample_rate_hz, uint32_t lna
   if (!set_vga_gain(vga_gain_db)) return false;
 
   // baseband filter bandwidth, pick a safe value near 1.75 MHz for FM capture bandwidth margin
-  r = hackrf_set_baseband_filter_bandwidth(dev_, 1750000);
+  r = hackrf_set_baseband_filter_bandwidth(dev_, bb_bw_hz_);
   if (r != HACKRF_SUCCESS) {
     log_msg(LogLevel::Warn, "set_baseband_filter_bandwidth failed: %s", hackrf_error_name((hackrf_error)r));
   }
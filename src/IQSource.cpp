@@ -0,0 +1,133 @@
+#include "IQSource.h"
+#include "HackRFDevice.h"
+#include "Logging.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+
+std::unique_ptr<IQSource> make_iq_source(const std::string& spec, const ReceiverConfig& cfg) {
+  if (spec.compare(0, 5, "file:") == 0) {
+    return std::unique_ptr<IQSource>(new FileIQSource(spec.substr(5)));
+  }
+  if (spec == "synth") {
+    return std::unique_ptr<IQSource>(new SyntheticIQSource(cfg.rf_freq_hz));
+  }
+  if (spec.compare(0, 6, "synth:") == 0) {
+    return std::unique_ptr<IQSource>(new SyntheticIQSource(std::atof(spec.c_str() + 6) * 1e6));
+  }
+  return std::unique_ptr<IQSource>(new HackRFDevice(spec));
+}
+
+PacedIQSource::~PacedIQSource() { stop_rx(); }
+
+bool PacedIQSource::configure(double freq_hz, double sample_rate_hz, uint32_t, uint32_t) {
+  if (sample_rate_hz <= 0.0) return false;
+  fs_ = sample_rate_hz;
+  lo_hz_ = freq_hz;
+  return true;
+}
+
+bool PacedIQSource::start_rx(RxCallback cb) {
+  if (running_ || fs_ <= 0.0) return false;
+  cb_ = std::move(cb);
+  running_ = true;
+  th_ = std::thread(&PacedIQSource::run, this);
+  return true;
+}
+
+void PacedIQSource::stop_rx() {
+  running_ = false;
+  if (th_.joinable()) th_.join();
+}
+
+void PacedIQSource::run() {
+  using clock = std::chrono::steady_clock;
+  std::vector<uint8_t> buf(USB_TRANSFER_BYTES);
+  const auto period = std::chrono::duration_cast<clock::duration>(
+      std::chrono::duration<double>(double(USB_TRANSFER_BYTES / 2) / fs_));
+  auto next = clock::now();
+  while (running_) {
+    if (!fill(buf.data(), buf.size())) break;
+    // deliver at the transfer's end time, like the USB stream would
+    next += period;
+    auto now = clock::now();
+    if (next > now) {
+      std::this_thread::sleep_until(next);
+    } else if (now - next > std::chrono::seconds(1)) {
+      next = now;   // stalled (debugger, suspend): do not burst to catch up
+    }
+    if (running_ && cb_) cb_(buf.data(), buf.size());
+  }
+}
+
+FileIQSource::~FileIQSource() { close(); }
+
+bool FileIQSource::open() {
+  if (f_) return true;
+  f_ = std::fopen(path_.c_str(), "rb");
+  if (!f_) {
+    log_msg(LogLevel::Error, "IQ file open failed: %s", path_.c_str());
+    return false;
+  }
+  log_msg(LogLevel::Info, "IQ file opened: %s", path_.c_str());
+  return true;
+}
+
+void FileIQSource::close() {
+  stop_rx();
+  if (f_) {
+    std::fclose(f_);
+    f_ = nullptr;
+  }
+}
+
+bool FileIQSource::fill(uint8_t* buf, size_t bytes) {
+  size_t got = 0;
+  bool rewound = false;
+  while (got < bytes) {
+    size_t n = std::fread(buf + got, 1, bytes - got, f_);
+    got += n;
+    if (n > 0) { rewound = false; continue; }
+    // loop; a second EOF in a row means the file is empty
+    if (rewound) {
+      log_msg(LogLevel::Error, "IQ file is empty: %s", path_.c_str());
+      return false;
+    }
+    std::rewind(f_);
+    rewound = true;
+  }
+  return true;
+}
+
+SyntheticIQSource::SyntheticIQSource(double station_hz) : station_hz_(station_hz) {
+  for (int i = 0; i < 1024; ++i) sin_[i] = float(std::sin(2.0 * M_PI * i / 1024.0));
+}
+
+std::string SyntheticIQSource::label() const {
+  char b[32];
+  std::snprintf(b, sizeof(b), "synth:%.3f", station_hz_ / 1e6);
+  return b;
+}
+
+bool SyntheticIQSource::fill(uint8_t* buf, size_t bytes) {
+  const double to_ph = 4294967296.0 / fs_;
+  const float off = float((station_hz_ - lo_hz_) * to_ph);
+  const float dev = float(22500.0 * to_ph);
+  const uint32_t tone_step = uint32_t(1000.0 * to_ph);
+  int8_t* out = reinterpret_cast<int8_t*>(buf);
+  for (size_t k = 0; k + 1 < bytes; k += 2) {
+    float f = off + dev * sin_[tone_ph_ >> 22];
+    tone_ph_ += tone_step;
+    carrier_ph_ += uint32_t(int64_t(f));
+    uint32_t idx = carrier_ph_ >> 22;
+    // LCG noise, about +-4 LSB
+    noise_ = noise_ * 1664525u + 1013904223u;
+    int ni = int((noise_ >> 24) & 7) - 4;
+    int nq = int((noise_ >> 16) & 7) - 4;
+    out[k]     = int8_t(int(60.0f * sin_[(idx + 256) & 1023]) + ni);
+    out[k + 1] = int8_t(int(60.0f * sin_[idx]) + nq);
+  }
+  return true;
+}
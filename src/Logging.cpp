@@ -0,0 +1,172 @@
+#include "Logging.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static constexpr size_t RING_SLOTS = 256;     // per thread, power of two
+static constexpr size_t TEXT_BYTES = 240;     // longer messages are truncated
+static constexpr auto DRAIN_PERIOD = std::chrono::milliseconds(20);
+
+namespace {
+
+struct Record {
+  uint64_t seq;
+  LogLevel lvl;
+  char text[TEXT_BYTES];
+};
+
+// Single producer (the owning thread), single consumer (the drainer).
+struct Ring {
+  Record slots[RING_SLOTS];
+  std::atomic<uint64_t> head{0};
+  std::atomic<uint64_t> tail{0};
+  std::atomic<bool> orphaned{false};   // owning thread has exited
+};
+
+class Logger {
+public:
+  Logger() : th_(&Logger::run, this) {}
+
+  ~Logger() {
+    {
+      std::lock_guard<std::mutex> lock(wake_m_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    th_.join();
+    drain();
+  }
+
+  Ring* attach() {
+    auto r = std::make_shared<Ring>();
+    std::lock_guard<std::mutex> lock(rings_m_);
+    rings_.push_back(r);
+    return r.get();
+  }
+
+  void write(Ring& r, LogLevel lvl, const char* fmt, va_list args) {
+    uint64_t h = r.head.load(std::memory_order_relaxed);
+    if (h - r.tail.load(std::memory_order_acquire) >= RING_SLOTS) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    Record& rec = r.slots[h & (RING_SLOTS - 1)];
+    rec.seq = seq_.fetch_add(1, std::memory_order_relaxed);
+    rec.lvl = lvl;
+    std::vsnprintf(rec.text, TEXT_BYTES, fmt, args);
+    r.head.store(h + 1, std::memory_order_release);
+  }
+
+  // Consumer side; serialized so log_flush() can run next to the drainer.
+  void drain() {
+    std::lock_guard<std::mutex> dlock(drain_m_);
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+      std::lock_guard<std::mutex> lock(rings_m_);
+      rings = rings_;
+    }
+
+    // merge threads back into call order
+    batch_.clear();
+    heads_.clear();
+    for (auto& r : rings) {
+      uint64_t t = r->tail.load(std::memory_order_relaxed);
+      uint64_t h = r->head.load(std::memory_order_acquire);
+      for (; t < h; ++t) batch_.push_back(&r->slots[t & (RING_SLOTS - 1)]);
+      heads_.push_back(h);
+    }
+    std::sort(batch_.begin(), batch_.end(),
+              [](const Record* a, const Record* b){ return a->seq < b->seq; });
+    for (const Record* rec : batch_) {
+      std::fprintf(stderr, "[%s] %s\n", prefix(rec->lvl), rec->text);
+    }
+
+    uint64_t d = dropped_.load(std::memory_order_relaxed);
+    if (d != reported_drops_) {
+      std::fprintf(stderr, "[WARN] logger: %llu message(s) dropped\n",
+                   (unsigned long long)(d - reported_drops_));
+      reported_drops_ = d;
+    }
+    std::fflush(stderr);
+
+    // release slots only after their text has been written
+    for (size_t i = 0; i < rings.size(); ++i) rings[i]->tail.store(heads_[i], std::memory_order_release);
+
+    std::lock_guard<std::mutex> lock(rings_m_);
+    rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const std::shared_ptr<Ring>& r) {
+      return r->orphaned.load() && r->head.load() == r->tail.load();
+    }), rings_.end());
+  }
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  static const char* prefix(LogLevel lvl) {
+    switch (lvl) {
+      case LogLevel::Warn: return "WARN";
+      case LogLevel::Error: return "ERR ";
+      case LogLevel::Debug: return "DBG ";
+      default: return "INFO";
+    }
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(wake_m_);
+    while (!stop_) {
+      wake_.wait_for(lock, DRAIN_PERIOD, [&]{ return stop_; });
+      lock.unlock();
+      drain();
+      lock.lock();
+    }
+  }
+
+  std::mutex rings_m_;
+  std::vector<std::shared_ptr<Ring>> rings_;
+
+  std::mutex drain_m_;
+  std::vector<const Record*> batch_;
+  std::vector<uint64_t> heads_;     // per ring, as collected
+  uint64_t reported_drops_ = 0;
+
+  std::atomic<uint64_t> seq_{0};
+  std::atomic<uint64_t> dropped_{0};
+
+  std::mutex wake_m_;
+  std::condition_variable wake_;
+  bool stop_ = false;
+  std::thread th_;
+};
+
+Logger& logger() {
+  static Logger l;
+  return l;
+}
+
+// Marks the ring orphaned when its thread exits; the drainer frees it once empty.
+struct RingHandle {
+  Ring* r = nullptr;
+  ~RingHandle() { if (r) r->orphaned.store(true); }
+};
+
+} // namespace
+
+void log_write(LogLevel lvl, const char* fmt, ...) {
+  Logger& l = logger();
+  thread_local RingHandle h;
+  if (!h.r) h.r = l.attach();
+  va_list args;
+  va_start(args, fmt);
+  l.write(*h.r, lvl, fmt, args);
+  va_end(args);
+}
+
+void log_flush() { logger().drain(); }
+
+uint64_t log_dropped() { return logger().dropped(); }
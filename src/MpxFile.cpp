@@ -0,0 +1,336 @@
+#include "MpxFile.h"
+#include "Logging.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <sys/types.h>
+
+static constexpr size_t HEADER_BYTES = 64;
+static constexpr size_t CHUNK_HDR_BYTES = 32;
+static constexpr size_t SAMPLE_BYTES = 2;     // int16 or float16
+static constexpr uint32_t VERSION = 1;
+// Discriminator output is an angle in [-pi, pi].
+static constexpr float INT16_SCALE = float(M_PI / 32767.0);
+
+static void put_u32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; ++i) p[i] = uint8_t(v >> (8 * i));
+}
+static void put_u64(uint8_t* p, uint64_t v) {
+  for (int i = 0; i < 8; ++i) p[i] = uint8_t(v >> (8 * i));
+}
+static void put_f64(uint8_t* p, double v) {
+  uint64_t u;
+  std::memcpy(&u, &v, 8);
+  put_u64(p, u);
+}
+static void put_f32(uint8_t* p, float v) {
+  uint32_t u;
+  std::memcpy(&u, &v, 4);
+  put_u32(p, u);
+}
+static uint32_t get_u32(const uint8_t* p) {
+  uint32_t v = 0;
+  for (int i = 0; i < 4; ++i) v |= uint32_t(p[i]) << (8 * i);
+  return v;
+}
+static uint64_t get_u64(const uint8_t* p) {
+  uint64_t v = 0;
+  for (int i = 0; i < 8; ++i) v |= uint64_t(p[i]) << (8 * i);
+  return v;
+}
+static double get_f64(const uint8_t* p) {
+  uint64_t u = get_u64(p);
+  double v;
+  std::memcpy(&v, &u, 8);
+  return v;
+}
+static float get_f32(const uint8_t* p) {
+  uint32_t u = get_u32(p);
+  float v;
+  std::memcpy(&v, &u, 4);
+  return v;
+}
+
+// IEEE half precision, round to nearest even; no F16C needed.
+static uint16_t f32_to_f16(float f) {
+  uint32_t u;
+  std::memcpy(&u, &f, 4);
+  uint32_t sign = u & 0x80000000u;
+  u ^= sign;
+  uint16_t h;
+  if (u >= 0x47800000u) {                 // >= 65536: inf, or NaN stays NaN
+    h = (u > 0x7f800000u) ? 0x7e00 : 0x7c00;
+  } else if (u < 0x38800000u) {           // half subnormal or zero
+    float v;
+    std::memcpy(&v, &u, 4);
+    v += 0.5f;                            // aligns the 10 mantissa bits at the bottom
+    uint32_t b;
+    std::memcpy(&b, &v, 4);
+    h = uint16_t(b - 0x3f000000u);
+  } else {
+    uint32_t odd = (u >> 13) & 1;
+    u += 0xc8000fffu + odd;               // rebias exponent, round
+    h = uint16_t(u >> 13);
+  }
+  return uint16_t(h | (sign >> 16));
+}
+
+static float f16_to_f32(uint16_t h) {
+  uint32_t sign = uint32_t(h & 0x8000) << 16;
+  uint32_t exp = (h >> 10) & 0x1f;
+  uint32_t mant = h & 0x3ff;
+  if (exp == 0) {
+    float v = float(mant) * (1.0f / 16777216.0f);
+    return sign ? -v : v;
+  }
+  uint32_t bits = sign | (exp == 31 ? 0x7f800000u : (exp + 112) << 23) | (mant << 13);
+  float f;
+  std::memcpy(&f, &bits, 4);
+  return f;
+}
+
+MpxWriter::~MpxWriter() { close(); }
+
+bool MpxWriter::open(const std::string& path, double fs_hz, double rf_freq_hz, MpxFormat fmt,
+                     uint32_t chunk_samples) {
+  close();
+  f_ = std::fopen(path.c_str(), "wb");
+  if (!f_) {
+    log_msg(LogLevel::Error, "MPX capture open failed: %s", path.c_str());
+    return false;
+  }
+  fmt_ = fmt;
+  chunk_samples_ = chunk_samples ? chunk_samples : 8192;
+  total_ = 0;
+  pend_.clear();
+  pend_n_ = 0;
+  index_.clear();
+
+  uint8_t h[HEADER_BYTES] = {};
+  std::memcpy(h, "FMMPX\0\0\0", 8);
+  put_u32(h + 8, VERSION);
+  put_u32(h + 12, uint32_t(fmt));
+  put_f64(h + 16, fs_hz);
+  put_f64(h + 24, rf_freq_hz);
+  put_f32(h + 32, fmt == MpxFormat::Int16 ? INT16_SCALE : 1.0f);
+  put_u32(h + 36, chunk_samples_);
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  put_u64(h + 40, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count()));
+  // total_samples and index_offset are filled in by close()
+  std::fwrite(h, 1, HEADER_BYTES, f_);
+  log_msg(LogLevel::Info, "MPX capture: %s, %.0f Hz, %s", path.c_str(), fs_hz,
+          fmt == MpxFormat::Int16 ? "int16" : "float16");
+  return true;
+}
+
+void MpxWriter::write(const float* x, size_t n, uint64_t t_ns, uint32_t epoch, bool gated) {
+  if (!f_) return;
+  while (n > 0) {
+    if (pend_n_ > 0 && (epoch != pend_info_.epoch || gated != pend_info_.gated)) flush_chunk();
+    if (pend_n_ == 0) {
+      pend_info_.first_sample = total_;
+      pend_info_.epoch = epoch;
+      pend_info_.gated = gated;
+    }
+    size_t take = std::min<size_t>(n, chunk_samples_ - pend_n_);
+    if (!gated) pend_.insert(pend_.end(), x, x + take);
+    pend_n_ += take;
+    total_ += take;
+    pend_info_.t_ns = t_ns;
+    if (x) x += take;
+    n -= take;
+    if (pend_n_ == chunk_samples_) flush_chunk();
+  }
+}
+
+void MpxWriter::flush_chunk() {
+  if (pend_n_ == 0) return;
+  index_.emplace_back(pend_info_.first_sample, uint64_t(ftello(f_)));
+
+  uint8_t h[CHUNK_HDR_BYTES];
+  std::memcpy(h, "MPXC", 4);
+  put_u32(h + 4, uint32_t(pend_n_));
+  put_u64(h + 8, pend_info_.first_sample);
+  put_u64(h + 16, pend_info_.t_ns);
+  put_u32(h + 24, pend_info_.epoch);
+  put_u32(h + 28, pend_info_.gated ? 1u : 0u);
+  std::fwrite(h, 1, CHUNK_HDR_BYTES, f_);
+
+  if (!pend_info_.gated) {
+    enc_.resize(pend_.size() * SAMPLE_BYTES);
+    uint8_t* p = enc_.data();
+    for (size_t i = 0; i < pend_.size(); ++i) {
+      uint16_t v;
+      if (fmt_ == MpxFormat::Int16) {
+        float s = std::max(-32767.0f, std::min(32767.0f, std::nearbyint(pend_[i] / INT16_SCALE)));
+        v = uint16_t(int16_t(s));
+      } else {
+        v = f32_to_f16(pend_[i]);
+      }
+      p[2*i] = uint8_t(v);
+      p[2*i + 1] = uint8_t(v >> 8);
+    }
+    std::fwrite(enc_.data(), 1, enc_.size(), f_);
+  }
+  pend_.clear();
+  pend_n_ = 0;
+}
+
+void MpxWriter::close() {
+  if (!f_) return;
+  flush_chunk();
+
+  uint64_t index_off = uint64_t(ftello(f_));
+  uint8_t b[16];
+  std::memcpy(b, "MPXI", 4);
+  put_u32(b + 4, uint32_t(index_.size()));
+  std::fwrite(b, 1, 8, f_);
+  for (const auto& e : index_) {
+    put_u64(b, e.first);
+    put_u64(b + 8, e.second);
+    std::fwrite(b, 1, 16, f_);
+  }
+
+  fseeko(f_, 48, SEEK_SET);
+  put_u64(b, total_);
+  put_u64(b + 8, index_off);
+  std::fwrite(b, 1, 16, f_);
+  std::fclose(f_);
+  f_ = nullptr;
+}
+
+MpxReader::~MpxReader() { close(); }
+
+bool MpxReader::open(const std::string& path) {
+  close();
+  f_ = std::fopen(path.c_str(), "rb");
+  if (!f_) {
+    log_msg(LogLevel::Error, "MPX file open failed: %s", path.c_str());
+    return false;
+  }
+  uint8_t h[HEADER_BYTES];
+  if (std::fread(h, 1, HEADER_BYTES, f_) != HEADER_BYTES || std::memcmp(h, "FMMPX\0\0\0", 8) != 0 ||
+      get_u32(h + 8) != VERSION || get_u32(h + 12) > 1) {
+    log_msg(LogLevel::Error, "Not an MPX capture (or unsupported version): %s", path.c_str());
+    close();
+    return false;
+  }
+  info_.format = MpxFormat(get_u32(h + 12));
+  info_.fs_hz = get_f64(h + 16);
+  info_.rf_freq_hz = get_f64(h + 24);
+  scale_ = get_f32(h + 32);
+  info_.chunk_samples = get_u32(h + 36);
+  info_.start_unix_ns = get_u64(h + 40);
+  info_.total_samples = get_u64(h + 48);
+  uint64_t index_off = get_u64(h + 56);
+
+  bool have_index = false;
+  if (index_off != 0 && fseeko(f_, off_t(index_off), SEEK_SET) == 0) {
+    uint8_t b[16];
+    if (std::fread(b, 1, 8, f_) == 8 && std::memcmp(b, "MPXI", 4) == 0) {
+      uint32_t count = get_u32(b + 4);
+      index_.reserve(count);
+      for (uint32_t k = 0; k < count && std::fread(b, 1, 16, f_) == 16; ++k) {
+        index_.emplace_back(get_u64(b), get_u64(b + 8));
+      }
+      have_index = index_.size() == count;
+    }
+  }
+  if (!have_index) {
+    log_msg(LogLevel::Warn, "MPX file has no index (not closed cleanly?), scanning chunks");
+    if (!scan_chunks()) {
+      close();
+      return false;
+    }
+  }
+  next_ = 0;
+  cur_.clear();
+  cur_pos_ = 0;
+  return true;
+}
+
+bool MpxReader::scan_chunks() {
+  index_.clear();
+  info_.total_samples = 0;
+  off_t off = off_t(HEADER_BYTES);
+  uint8_t h[CHUNK_HDR_BYTES];
+  while (fseeko(f_, off, SEEK_SET) == 0 && std::fread(h, 1, CHUNK_HDR_BYTES, f_) == CHUNK_HDR_BYTES &&
+         std::memcmp(h, "MPXC", 4) == 0) {
+    uint32_t n = get_u32(h + 4);
+    index_.emplace_back(get_u64(h + 8), uint64_t(off));
+    info_.total_samples = get_u64(h + 8) + n;
+    bool gated = get_u32(h + 28) & 1;
+    off += off_t(CHUNK_HDR_BYTES + (gated ? 0 : n * SAMPLE_BYTES));
+  }
+  // a chunk cut short by the crash is dropped by load_chunk
+  return true;
+}
+
+void MpxReader::close() {
+  if (f_) std::fclose(f_);
+  f_ = nullptr;
+  index_.clear();
+  cur_.clear();
+  cur_pos_ = 0;
+  next_ = 0;
+  info_ = MpxInfo();
+}
+
+bool MpxReader::load_chunk(size_t k) {
+  cur_.clear();
+  cur_pos_ = 0;
+  if (k >= index_.size() || fseeko(f_, off_t(index_[k].second), SEEK_SET) != 0) return false;
+  uint8_t h[CHUNK_HDR_BYTES];
+  if (std::fread(h, 1, CHUNK_HDR_BYTES, f_) != CHUNK_HDR_BYTES || std::memcmp(h, "MPXC", 4) != 0) return false;
+  uint32_t n = get_u32(h + 4);
+  cur_info_.first_sample = get_u64(h + 8);
+  cur_info_.t_ns = get_u64(h + 16);
+  cur_info_.epoch = get_u32(h + 24);
+  cur_info_.gated = get_u32(h + 28) & 1;
+
+  cur_.resize(n);
+  if (cur_info_.gated) {
+    std::fill(cur_.begin(), cur_.end(), 0.0f);
+  } else {
+    raw_.resize(size_t(n) * SAMPLE_BYTES);
+    if (std::fread(raw_.data(), 1, raw_.size(), f_) != raw_.size()) {
+      cur_.clear();
+      return false;
+    }
+    const uint8_t* p = raw_.data();
+    for (uint32_t i = 0; i < n; ++i) {
+      uint16_t v = uint16_t(p[2*i] | (p[2*i + 1] << 8));
+      cur_[i] = (info_.format == MpxFormat::Int16) ? float(int16_t(v)) * scale_ : f16_to_f32(v);
+    }
+  }
+  next_ = k + 1;
+  return true;
+}
+
+size_t MpxReader::read(float* out, size_t max, MpxChunkInfo* ci) {
+  if (!f_) return 0;
+  if (cur_pos_ >= cur_.size()) {
+    if (!load_chunk(next_)) return 0;
+  }
+  size_t n = std::min(max, cur_.size() - cur_pos_);
+  std::copy(cur_.begin() + cur_pos_, cur_.begin() + cur_pos_ + n, out);
+  if (ci) {
+    *ci = cur_info_;
+    ci->first_sample += cur_pos_;
+  }
+  cur_pos_ += n;
+  return n;
+}
+
+bool MpxReader::seek(uint64_t sample) {
+  if (!f_ || index_.empty()) return false;
+  // last chunk starting at or before sample
+  auto it = std::upper_bound(index_.begin(), index_.end(), sample,
+                             [](uint64_t s, const std::pair<uint64_t, uint64_t>& e){ return s < e.first; });
+  if (it == index_.begin()) return false;
+  size_t k = size_t(it - index_.begin()) - 1;
+  if (!load_chunk(k)) return false;
+  cur_pos_ = size_t(std::min<uint64_t>(sample - cur_info_.first_sample, cur_.size()));
+  return true;
+}
@@ -0,0 +1,51 @@
+#include "OverloadGovernor.h"
+#include "Logging.h"
+#include <cmath>
+
+static constexpr double RTF_TAU_S = 1.0;
+static constexpr double DOWN_RTF = 0.85;
+static constexpr double DOWN_HOLD_S = 0.5;
+// Stepping up adds back cost, so require clear headroom for a while.
+static constexpr double UP_RTF = 0.45;
+static constexpr double UP_HOLD_S = 5.0;
+static constexpr double MIN_DWELL_S = 2.0;
+
+const char* OverloadGovernor::tier_name(int tier) {
+  switch (tier) {
+    case 0: return "full";
+    case 1: return "no RDS";
+    case 2: return "short filters";
+    case 3: return "fast discriminator";
+    default: return "?";
+  }
+}
+
+bool OverloadGovernor::update(double proc_s, double block_s, bool overrun) {
+  if (block_s <= 0.0) return false;
+  double inst = proc_s / block_s;
+  double a = 1.0 - std::exp(-block_s / RTF_TAU_S);
+  rtf_ += a * (inst - rtf_);
+  since_change_s_ += block_s;
+
+  hot_s_ = (rtf_ > DOWN_RTF) ? hot_s_ + block_s : 0.0;
+  cool_s_ = (rtf_ < UP_RTF) ? cool_s_ + block_s : 0.0;
+
+  int next = tier_;
+  // give the RTF average time to reflect the last change, unless samples are being lost
+  bool down = (overrun && since_change_s_ >= DOWN_HOLD_S) ||
+              (hot_s_ >= DOWN_HOLD_S && since_change_s_ >= MIN_DWELL_S);
+  if (down && tier_ < MAX_TIER) {
+    next = tier_ + 1;
+  } else if (cool_s_ >= UP_HOLD_S && tier_ > 0 && since_change_s_ >= MIN_DWELL_S) {
+    next = tier_ - 1;
+  }
+  if (next == tier_) return false;
+
+  log_msg(next > tier_ ? LogLevel::Warn : LogLevel::Info,
+          "Overload governor: tier %d (%s) -> %d (%s), RTF %.2f%s",
+          tier_, tier_name(tier_), next, tier_name(next), rtf_, overrun ? ", IQ overrun" : "");
+  tier_ = next;
+  hot_s_ = cool_s_ = 0.0;
+  since_change_s_ = 0.0;
+  return true;
+}
@@ -1,6 +1,7 @@
 #include "RDSDecoder.h"
 #include "dsp/FirDesign.h"
 #include "dsp/NCO.h"
+#include "LatencyStats.h"
 #include "Logging.h"
 #include <array>
 #include <cstring>
@@ -26,8 +27,11 @@ static constexpr uint16_t OFF_C  = 0x168;
 static constexpr uint16_t OFF_D  = 0x1B4;
 static constexpr uint16_t OFF_Cp = 0x350;
 
+static constexpr double BACKOFF_MIN_S = 5.0;
+static constexpr double BACKOFF_MAX_S = 60.0;
+
 RDSDecoder::RDSDecoder(double fs_mpx)
-  : fs_(fs_mpx) {
+  : fs_(fs_mpx), det_(fs_mpx) {
   // Bandpass around 57 kHz in MPX (fs about 192 kHz)
   int ntaps_bp = 161;
   bp_ = FIRDecimatorR(design_bandpass(float(fs_), 54000.0f, 60000.0f, ntaps_bp), 1);
@@ -41,23 +45,83 @@ RDSDecoder::RDSDecoder(double fs_mpx)
 }
 
 void RDSDecoder::reset() {
+  reset_chain();
+  std::fill(ps_.begin(), ps_.end(), ' ');
+  ps_[8] = '\0';
+  last_ps_ = ps_;
+  {
+    std::lock_guard<std::mutex> lock(ps_m_);
+    station_ps_.clear();
+    station_pi_ = 0;
+  }
+
+  // a new station is probed afresh
+  det_.reset();
+  engaged_ = false;
+  backoff_s_ = BACKOFF_MIN_S;
+  std::lock_guard<std::mutex> lock(stats_m_);
+  stats_.engaged = false;
+}
+
+void RDSDecoder::reset_chain() {
   bp_.reset();
   lp_.reset();
   chip_phase_ = 0.0;
   chip_inc_ = 2375.0 / fs_; // chips per second
   have_sync_ = false;
   block_idx_ = 0;
+  block_errs_ = 0;
   shift_ = 0;
   bits_in_shift_ = 0;
-  std::fill(ps_.begin(), ps_.end(), ' ');
-  ps_[8] = '\0';
-  last_ps_ = ps_;
+}
+
+void RDSDecoder::set_auto(bool on, double sync_loss_s) {
+  auto_ = on;
+  sync_loss_ = size_t(sync_loss_s * fs_);
+}
+
+RdsAutoStats RDSDecoder::auto_stats() const {
+  std::lock_guard<std::mutex> lock(stats_m_);
+  return stats_;
+}
+
+void RDSDecoder::idle(const float* mpx, size_t n) {
+  uint64_t t0 = mono_ns();
+  bool probed = det_.process(mpx, n);
+  double probe_ns = double(mono_ns() - t0);
+
+  bool engage = probed && det_.present();
+  if (engage) {
+    engaged_ = true;
+    since_good_ = 0;
+    good_seen_ = false;
+    reset_chain();
+    log_msg(LogLevel::Info, "RDS: subcarrier found (%.1f dB over floor, %.1f dB re pilot), decoder on",
+            det_.snr_db(), det_.pilot_db());
+  }
+  std::lock_guard<std::mutex> lock(stats_m_);
+  stats_.idle_s += double(n) / fs_;
+  stats_.saved_cpu_s += (chain_ns_ * double(n) - probe_ns) * 1e-9;
+  if (probed) {
+    stats_.snr_db = det_.snr_db();
+    stats_.pilot_db = det_.pilot_db();
+  }
+  if (engage) {
+    stats_.engaged = true;
+    stats_.engages++;
+  }
 }
 
 static inline int slicer(float x) { return (x >= 0.0f) ? 1 : 0; }
 
 void RDSDecoder::process(const float* mpx, size_t n) {
   if (!enabled_) return;
+  // (the first blocks always run the chain, to learn what skipping it saves)
+  if (auto_ && !engaged_ && chain_runs_ >= 2) {
+    idle(mpx, n);
+    return;
+  }
+  uint64_t t0 = auto_ ? mono_ns() : 0;
 
   // 1) bandpass 57 kHz
   tmp1_.resize(n);
@@ -99,6 +163,27 @@ void RDSDecoder::process(const float* mpx, size_t n) {
       }
     }
   }
+
+  if (!auto_) return;
+  // the first run sizes the scratch buffers; leave it out
+  double ns = double(mono_ns() - t0) / double(std::max<size_t>(n, 1));
+  if (chain_runs_++ > 0) chain_ns_ = chain_ns_ > 0.0 ? 0.9 * chain_ns_ + 0.1 * ns : ns;
+  if (!engaged_) return;
+  since_good_ += n;
+  if (since_good_ < sync_loss_) return;
+
+  // Sustained sync loss: back to probing. A subcarrier that never gave a
+  // clean group (not RDS, or too weak) is probed less and less often.
+  engaged_ = false;
+  det_.reset();
+  if (!good_seen_) {
+    det_.hold_off(backoff_s_);
+    backoff_s_ = std::min(2.0 * backoff_s_, BACKOFF_MAX_S);
+  }
+  log_msg(LogLevel::Info, "RDS: no clean group for %.1f s, decoder off", double(since_good_) / fs_);
+  std::lock_guard<std::mutex> lock(stats_m_);
+  stats_.engaged = false;
+  stats_.disengages++;
 }
 
 void RDSDecoder::push_bit(int bit) {
@@ -129,24 +214,48 @@ void RDSDecoder::push_bit(int bit) {
       block_idx_ = 0;
       blocks_[0] = data;
       block_idx_ = 1;
+      block_errs_ = 0;
+      bits_in_shift_ = 0;
     }
     return;
   }
+  // in sync: the next block is the next 26 bits
+  bits_in_shift_ = 0;
 
   // Expect A,B,C,D in order
+  if (which != block_idx_) block_errs_ |= uint8_t(1u << block_idx_);
   blocks_[block_idx_] = data;
   block_idx_++;
 
   if (block_idx_ == 4) {
-    handle_group(blocks_[0], blocks_[1], blocks_[2], blocks_[3]);
+    handle_group(blocks_[0], blocks_[1], blocks_[2], blocks_[3], block_errs_);
     block_idx_ = 0;
+    block_errs_ = 0;
   }
 }
 
-void RDSDecoder::handle_group(uint16_t A, uint16_t B, uint16_t C, uint16_t D) {
-  (void)A; (void)C;
+void RDSDecoder::handle_group(uint16_t A, uint16_t B, uint16_t C, uint16_t D, uint8_t errs) {
+  if (errs == 0) {
+    since_good_ = 0;
+    good_seen_ = true;
+    backoff_s_ = BACKOFF_MIN_S;
+  }
+  if (on_group_ && errs != 0xF) {
+    RdsGroup g;
+    g.blocks[0] = A;
+    g.blocks[1] = B;
+    g.blocks[2] = C;
+    g.blocks[3] = D;
+    g.errors = errs;
+    on_group_(g);
+  }
+  {
+    std::lock_guard<std::mutex> lock(ps_m_);
+    station_pi_ = A;
+  }
   uint8_t group_type = uint8_t((B >> 12) & 0xF);
   uint8_t version = uint8_t((B >> 11) & 0x1);
+  log_msg(LogLevel::Debug, "RDS group %u%c PI %04X", unsigned(group_type), version ? 'B' : 'A', unsigned(A));
 
   if (group_type == 0) {
     // Program Service name in block D, segment index in B bits 0..1
@@ -159,12 +268,23 @@ void RDSDecoder::handle_group(uint16_t A, uint16_t B, uint16_t C, uint16_t D) {
       ps_[8] = '\0';
       if (ps_ != last_ps_) {
         last_ps_ = ps_;
-        station_ps_ = std::string(ps_.data());
-        log_msg(LogLevel::Info, "RDS PS: %s (group 0%c)", station_ps_.c_str(), version ? 'B' : 'A');
+        {
+          std::lock_guard<std::mutex> lock(ps_m_);
+          station_ps_ = std::string(ps_.data());
+        }
+        log_msg(LogLevel::Info, "RDS PS: %s (group 0%c)", ps_.data(), version ? 'B' : 'A');
       }
     }
   }
 }
 
-std::string RDSDecoder::program_service() const { return station_ps_; }
+uint16_t RDSDecoder::program_id() const {
+  std::lock_guard<std::mutex> lock(ps_m_);
+  return station_pi_;
+}
+
+std::string RDSDecoder::program_service() const {
+  std::lock_guard<std::mutex> lock(ps_m_);
+  return station_ps_;
+}
 void RDSDecoder::set_enabled(bool en) { enabled_ = en; }
@@ -0,0 +1,241 @@
+#include "RdsArchive.h"
+#include "Logging.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Segment layout; the file is mapped as-is, so fields are host order
+// (little-endian on every target we build for).
+static constexpr uint32_t SEG_VERSION = 1;
+static constexpr uint64_t SEG_CAPACITY = 1u << 20;       // records, about a day at 11.4 groups/s
+static constexpr uint64_t INDEX_STRIDE = 256;
+static constexpr size_t HEADER_BYTES = 4096;
+static constexpr size_t INDEX_BYTES = (SEG_CAPACITY / INDEX_STRIDE) * sizeof(uint64_t);
+static constexpr size_t RECORDS_OFF = HEADER_BYTES + INDEX_BYTES;
+
+struct SegHeader {
+  char magic[8];            // "FMRDSSEG"
+  uint32_t version;
+  uint16_t pi;
+  uint16_t reserved0;
+  double rf_freq_hz;
+  uint64_t capacity;
+  uint64_t index_stride;
+  uint64_t first_us;
+  uint64_t last_us;
+  uint64_t count;           // published with release ordering after each record
+};
+
+struct SegRecord {
+  uint64_t t_flags;         // time_us in bits 0..59, block error flags in 60..63
+  uint16_t b[4];
+};
+static_assert(sizeof(SegRecord) == 16, "record layout");
+static_assert(sizeof(SegHeader) <= HEADER_BYTES, "header layout");
+
+static constexpr uint64_t TIME_MASK = (uint64_t(1) << 60) - 1;
+
+static size_t seg_bytes(uint64_t records) { return RECORDS_OFF + size_t(records) * sizeof(SegRecord); }
+
+static std::string station_dir(const std::string& root, uint16_t pi) {
+  char b[8];
+  std::snprintf(b, sizeof(b), "%04X", unsigned(pi));
+  return root + "/" + b;
+}
+
+static bool make_dir(const std::string& path) {
+  if (mkdir(path.c_str(), 0755) == 0 || errno == EEXIST) return true;
+  log_msg(LogLevel::Error, "RDS archive: mkdir %s failed (%s)", path.c_str(), std::strerror(errno));
+  return false;
+}
+
+uint64_t rds_now_us() {
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+}
+
+RdsArchiveWriter::~RdsArchiveWriter() { close(); }
+
+bool RdsArchiveWriter::open(const std::string& root) {
+  close();
+  if (root.empty() || !make_dir(root)) return false;
+  root_ = root;
+  total_ = 0;
+  log_msg(LogLevel::Info, "RDS archive: %s", root_.c_str());
+  return true;
+}
+
+void RdsArchiveWriter::close() {
+  finish_segment();
+  root_.clear();
+}
+
+bool RdsArchiveWriter::start_segment(uint16_t pi, uint64_t t_us, double rf_freq_hz) {
+  std::string dir = station_dir(root_, pi);
+  if (!make_dir(dir)) return false;
+  std::string path = dir + "/" + std::to_string(t_us) + ".rds";
+
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    log_msg(LogLevel::Error, "RDS archive: create %s failed (%s)", path.c_str(), std::strerror(errno));
+    return false;
+  }
+  // sparse until written; trimmed to the records used when the segment ends
+  size_t len = seg_bytes(SEG_CAPACITY);
+  void* p = MAP_FAILED;
+  if (ftruncate(fd, off_t(len)) == 0) p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    log_msg(LogLevel::Error, "RDS archive: map %s failed (%s)", path.c_str(), std::strerror(errno));
+    ::close(fd);
+    unlink(path.c_str());
+    return false;
+  }
+
+  fd_ = fd;
+  map_ = static_cast<uint8_t*>(p);
+  map_len_ = len;
+  pi_ = pi;
+  count_ = 0;
+
+  SegHeader* h = reinterpret_cast<SegHeader*>(map_);
+  std::memcpy(h->magic, "FMRDSSEG", 8);
+  h->version = SEG_VERSION;
+  h->pi = pi;
+  h->rf_freq_hz = rf_freq_hz;
+  h->capacity = SEG_CAPACITY;
+  h->index_stride = INDEX_STRIDE;
+  h->first_us = t_us;
+  h->last_us = t_us;
+  __atomic_store_n(&h->count, uint64_t(0), __ATOMIC_RELEASE);
+  log_msg(LogLevel::Info, "RDS archive: new segment %s", path.c_str());
+  return true;
+}
+
+void RdsArchiveWriter::finish_segment() {
+  if (!map_) return;
+  munmap(map_, map_len_);
+  map_ = nullptr;
+  if (ftruncate(fd_, off_t(seg_bytes(count_))) != 0) {
+    log_msg(LogLevel::Warn, "RDS archive: trim failed (%s)", std::strerror(errno));
+  }
+  ::close(fd_);
+  fd_ = -1;
+}
+
+void RdsArchiveWriter::append(const RdsGroup& g, uint64_t t_us, double rf_freq_hz) {
+  if (root_.empty()) return;
+  bool pi_ok = !(g.errors & 1);
+  if (!map_ || count_ == SEG_CAPACITY || (pi_ok && g.pi() != pi_)) {
+    if (!map_ && !pi_ok) return;            // no station yet to file it under
+    uint16_t pi = pi_ok ? g.pi() : pi_;
+    finish_segment();
+    if (!start_segment(pi, t_us, rf_freq_hz)) return;
+  }
+
+  SegHeader* h = reinterpret_cast<SegHeader*>(map_);
+  // keep records in time order if the wall clock steps back
+  t_us = std::max(t_us, h->last_us);
+
+  SegRecord* r = reinterpret_cast<SegRecord*>(map_ + RECORDS_OFF) + count_;
+  r->t_flags = (t_us & TIME_MASK) | (uint64_t(g.errors & 0xF) << 60);
+  std::memcpy(r->b, g.blocks, sizeof(r->b));
+  if (count_ % INDEX_STRIDE == 0) {
+    reinterpret_cast<uint64_t*>(map_ + HEADER_BYTES)[count_ / INDEX_STRIDE] = t_us;
+  }
+  h->last_us = t_us;
+  count_++;
+  total_++;
+  __atomic_store_n(&h->count, count_, __ATOMIC_RELEASE);
+}
+
+// Segment files of one station, sorted by first record time.
+static std::vector<std::pair<uint64_t, std::string>> list_segments(const std::string& dir) {
+  std::vector<std::pair<uint64_t, std::string>> out;
+  DIR* d = opendir(dir.c_str());
+  if (!d) return out;
+  while (dirent* e = readdir(d)) {
+    const char* name = e->d_name;
+    size_t len = std::strlen(name);
+    if (len < 5 || std::strcmp(name + len - 4, ".rds") != 0) continue;
+    out.emplace_back(std::strtoull(name, nullptr, 10), dir + "/" + name);
+  }
+  closedir(d);
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+bool RdsArchiveReader::query(uint16_t pi, uint64_t t1_us, uint64_t t2_us,
+                             const std::function<bool(const RdsRecord&)>& fn) const {
+  auto segs = list_segments(station_dir(root_, pi));
+  if (segs.empty()) return false;
+
+  for (size_t s = 0; s < segs.size(); ++s) {
+    if (segs[s].first >= t2_us) break;
+    // a segment ends where the next one starts
+    if (s + 1 < segs.size() && segs[s + 1].first <= t1_us) continue;
+
+    int fd = ::open(segs[s].second.c_str(), O_RDONLY);
+    if (fd < 0) continue;
+    struct stat st;
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) >= RECORDS_OFF) {
+      p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (p == MAP_FAILED) continue;
+
+    const uint8_t* base = static_cast<const uint8_t*>(p);
+    const SegHeader* h = reinterpret_cast<const SegHeader*>(base);
+    bool more = true;
+    if (std::memcmp(h->magic, "FMRDSSEG", 8) == 0 && h->version == SEG_VERSION) {
+      uint64_t count = __atomic_load_n(&h->count, __ATOMIC_ACQUIRE);
+      count = std::min<uint64_t>(count, (uint64_t(st.st_size) - RECORDS_OFF) / sizeof(SegRecord));
+      const uint64_t* idx = reinterpret_cast<const uint64_t*>(base + HEADER_BYTES);
+      const SegRecord* rec = reinterpret_cast<const SegRecord*>(base + RECORDS_OFF);
+
+      // last stride starting at or before t1
+      size_t n_idx = size_t((count + INDEX_STRIDE - 1) / INDEX_STRIDE);
+      size_t k = size_t(std::upper_bound(idx, idx + n_idx, t1_us) - idx);
+      uint64_t i = (k > 0 ? k - 1 : 0) * INDEX_STRIDE;
+
+      RdsRecord out;
+      for (; i < count && more; ++i) {
+        uint64_t t = rec[i].t_flags & TIME_MASK;
+        if (t < t1_us) continue;
+        if (t >= t2_us) {
+          more = false;
+          break;
+        }
+        out.t_us = t;
+        out.group.errors = uint8_t(rec[i].t_flags >> 60);
+        std::memcpy(out.group.blocks, rec[i].b, sizeof(out.group.blocks));
+        more = fn(out);
+      }
+    }
+    munmap(p, size_t(st.st_size));
+    if (!more) break;
+  }
+  return true;
+}
+
+std::vector<uint16_t> RdsArchiveReader::stations() const {
+  std::vector<uint16_t> out;
+  DIR* d = opendir(root_.c_str());
+  if (!d) return out;
+  while (dirent* e = readdir(d)) {
+    char* end = nullptr;
+    unsigned long v = std::strtoul(e->d_name, &end, 16);
+    if (std::strlen(e->d_name) == 4 && end && *end == '\0') out.push_back(uint16_t(v));
+  }
+  closedir(d);
+  std::sort(out.begin(), out.end());
+  return out;
+}
@@ -0,0 +1,128 @@
+#include "RdsDetector.h"
+#include <algorithm>
+#include <cmath>
+
+static constexpr double WINDOW_S = 0.02;
+static constexpr float OPEN_DB = 6.0f;
+static constexpr float CLOSE_DB = 3.0f;
+static constexpr float SMOOTH = 0.3f;   // weight of the newest probe
+static constexpr size_t GROUP = 3;      // bins per group; the strongest is dropped
+
+static std::vector<float> bins_at(double fs, double center, std::initializer_list<double> offs) {
+  std::vector<float> c;
+  for (double o : offs) c.push_back(float(2.0 * std::cos(2.0 * M_PI * (center + o) / fs)));
+  return c;
+}
+
+RdsDetector::RdsDetector(double fs_mpx, double period_s) : fs_(fs_mpx) {
+  window_ = std::max<size_t>(256, size_t(fs_ * WINDOW_S));
+  // Hann: keeps nearby tones (a 1 kHz comb, a stereo spur) out of the bins
+  win_.resize(window_);
+  for (size_t i = 0; i < window_; ++i) win_[i] = float(0.5 - 0.5 * std::cos(2.0 * M_PI * double(i) / double(window_)));
+  buf_.resize(window_);
+  size_t period = size_t(fs_ * period_s);
+  gap_ = period > window_ ? period - window_ : 0;
+  // biphase RDS peaks about 1 kHz either side of 57 kHz; nothing is
+  // broadcast between the RDS band (to 59.4 kHz) and 63 kHz
+  for (float c : bins_at(fs_, 57000.0, {-1300.0, -1000.0, -700.0, 700.0, 1000.0, 1300.0})) side_.push_back({c});
+  for (float c : bins_at(fs_, 61500.0, {-1000.0, -600.0, -200.0, 200.0, 600.0, 1000.0})) floor_.push_back({c});
+  pilot_.coef = float(2.0 * std::cos(2.0 * M_PI * 19000.0 / fs_));
+}
+
+void RdsDetector::reset() {
+  fill_ = 0;
+  skip_ = 0;
+  primed_ = false;
+  present_ = false;
+  for (auto& b : side_) b.s1 = b.s2 = 0.0f;
+  for (auto& b : floor_) b.s1 = b.s2 = 0.0f;
+  pilot_.s1 = pilot_.s2 = 0.0f;
+}
+
+void RdsDetector::hold_off(double s) {
+  fill_ = 0;
+  skip_ = size_t(std::max(0.0, s) * fs_);
+  for (auto& b : side_) b.s1 = b.s2 = 0.0f;
+  for (auto& b : floor_) b.s1 = b.s2 = 0.0f;
+  pilot_.s1 = pilot_.s2 = 0.0f;
+}
+
+static void goertzel(float coef, float& s1, float& s2, const float* x, size_t n) {
+  float a = s1, b = s2;
+  for (size_t i = 0; i < n; ++i) {
+    float s0 = x[i] + coef * a - b;
+    b = a;
+    a = s0;
+  }
+  s1 = a;
+  s2 = b;
+}
+
+bool RdsDetector::process(const float* mpx, size_t n) {
+  bool done = false;
+  size_t k = 0;
+  while (k < n) {
+    if (skip_ > 0) {
+      size_t s = std::min(skip_, n - k);
+      skip_ -= s;
+      k += s;
+      continue;
+    }
+    size_t take = std::min(window_ - fill_, n - k);
+    float* x = buf_.data();
+    for (size_t j = 0; j < take; ++j) x[j] = mpx[k + j] * win_[fill_ + j];
+    for (auto& b : side_) goertzel(b.coef, b.s1, b.s2, x, take);
+    for (auto& b : floor_) goertzel(b.coef, b.s1, b.s2, x, take);
+    goertzel(pilot_.coef, pilot_.s1, pilot_.s2, x, take);
+    fill_ += take;
+    k += take;
+    if (fill_ == window_) {
+      finish();
+      done = true;
+    }
+  }
+  return done;
+}
+
+// Mean power of GROUP bins without the strongest: RDS and noise fill every
+// bin, a tone or a spur only one. Clears the bins for the next probe.
+float RdsDetector::trimmed_power(Bin* b) {
+  float sum = 0.0f, top = 0.0f;
+  for (size_t i = 0; i < GROUP; ++i) {
+    float p = power(b[i]);
+    sum += p;
+    top = std::max(top, p);
+    b[i].s1 = b[i].s2 = 0.0f;
+  }
+  return (sum - top) / float(GROUP - 1);
+}
+
+void RdsDetector::finish() {
+  // both sidebands must stand out: clutter is rarely symmetric about 57 kHz
+  float lo = trimmed_power(&side_[0]);
+  float hi = trimmed_power(&side_[GROUP]);
+  float floor = 0.5f * (trimmed_power(&floor_[0]) + trimmed_power(&floor_[GROUP]));
+  float pilot = power(pilot_);
+  pilot_.s1 = pilot_.s2 = 0.0f;
+
+  float w = primed_ ? SMOOTH : 1.0f;
+  lo_p_ += w * (lo - lo_p_);
+  hi_p_ += w * (hi - hi_p_);
+  floor_p_ += w * (floor - floor_p_);
+  pilot_p_ += w * (pilot - pilot_p_);
+  primed_ = true;
+
+  float snr = snr_db();
+  if (!present_ && snr > OPEN_DB) present_ = true;
+  else if (present_ && snr < CLOSE_DB) present_ = false;
+  fill_ = 0;
+  skip_ = gap_;
+}
+
+float RdsDetector::snr_db() const {
+  return 10.0f * std::log10((std::min(lo_p_, hi_p_) + 1e-30f) / (floor_p_ + 1e-30f));
+}
+
+float RdsDetector::pilot_db() const {
+  return 10.0f * std::log10((0.5f * (lo_p_ + hi_p_) + 1e-30f) / (pilot_p_ + 1e-30f));
+}
@@ -0,0 +1,98 @@
+#include "RealTime.h"
+#include "Logging.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+static constexpr size_t STACK_PREFAULT = 256 * 1024;
+
+static void prefault_stack() {
+  volatile char buf[STACK_PREFAULT];
+  for (size_t i = 0; i < sizeof(buf); i += 4096) buf[i] = 0;
+}
+
+bool apply_thread_policy(const std::string& name, const ThreadPolicy& p) {
+  bool ok = true;
+  if (p.cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(p.cpu, &set);
+    int r = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (r == 0) {
+      log_msg(LogLevel::Info, "RT: %s pinned to CPU %d: applied", name.c_str(), p.cpu);
+    } else {
+      log_msg(LogLevel::Warn, "RT: %s pinned to CPU %d: denied (%s)", name.c_str(), p.cpu, std::strerror(r));
+      ok = false;
+    }
+  }
+  if (p.fifo_prio > 0) {
+    sched_param sp{};
+    sp.sched_priority = p.fifo_prio;
+    int r = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+    if (r == 0) {
+      log_msg(LogLevel::Info, "RT: %s SCHED_FIFO priority %d: applied", name.c_str(), p.fifo_prio);
+    } else {
+      // EPERM without CAP_SYS_NICE or an RLIMIT_RTPRIO allowance
+      log_msg(LogLevel::Warn, "RT: %s SCHED_FIFO priority %d: denied (%s)",
+              name.c_str(), p.fifo_prio, std::strerror(r));
+      ok = false;
+    }
+  }
+  if (!p.empty()) prefault_stack();
+  return ok;
+}
+
+bool lock_memory() {
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+    log_msg(LogLevel::Info, "RT: mlockall: applied");
+    return true;
+  }
+  int e = errno;
+  rlimit rl{};
+  getrlimit(RLIMIT_MEMLOCK, &rl);
+  log_msg(LogLevel::Warn, "RT: mlockall: denied (%s, RLIMIT_MEMLOCK %llu KB)", std::strerror(e),
+          rl.rlim_cur == RLIM_INFINITY ? 0ULL : (unsigned long long)(rl.rlim_cur / 1024));
+  return false;
+}
+
+void prefault(void* p, size_t bytes) {
+  if (!p || bytes == 0) return;
+  const size_t page = size_t(sysconf(_SC_PAGESIZE));
+  volatile char* c = static_cast<volatile char*>(p);
+  // read-modify-write keeps the contents
+  for (size_t i = 0; i < bytes; i += page) c[i] = c[i];
+  c[bytes - 1] = c[bytes - 1];
+}
+
+long page_faults() {
+  rusage ru{};
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_minflt + ru.ru_majflt;
+}
+
+bool parse_cpu_list(const char* s, std::vector<int>& out) {
+  std::vector<int> v;
+  while (true) {
+    char* end = nullptr;
+    long c = std::strtol(s, &end, 10);
+    if (end == s || *s < '0' || *s > '9' || c >= CPU_SETSIZE) return false;
+    v.push_back(int(c));
+    if (*end == '\0') break;
+    if (*end != ',') return false;
+    s = end + 1;
+  }
+  out = v;
+  return true;
+}
+
+bool parse_cpu(const char* s, int& cpu) {
+  std::vector<int> v;
+  if (!parse_cpu_list(s, v) || v.size() != 1) return false;
+  cpu = v[0];
+  return true;
+}
@@ -0,0 +1,101 @@
+#include "ReceiverSet.h"
+#include "Logging.h"
+#include <algorithm>
+
+// out.wav -> out_<i>.wav
+static std::string indexed_path(const std::string& stem, size_t i) {
+  std::string idx = "_" + std::to_string(i);
+  size_t dot = stem.rfind('.');
+  if (dot == std::string::npos || stem.find('/', dot) != std::string::npos) return stem + idx;
+  return stem.substr(0, dot) + idx + stem.substr(dot);
+}
+
+ReceiverSet::ReceiverSet(const ReceiverConfig& base) : base_(base) {}
+
+ReceiverSet::~ReceiverSet() { stop(); }
+
+bool ReceiverSet::add(const std::string& device, double freq_hz) {
+  std::unique_ptr<Unit> u(new Unit());
+  u->cfg = base_;
+  u->cfg.device = device;
+  u->cfg.rf_freq_hz = freq_hz;
+  u->cfg.wav_path = indexed_path(base_.wav_path, units_.size());
+  if (!base_.mpx_path.empty()) u->cfg.mpx_path = indexed_path(base_.mpx_path, units_.size());
+  // spectrum files are per receiver; a UDP listener tells them apart by center frequency
+  for (std::string* s : {&u->cfg.spectrum_iq, &u->cfg.spectrum_ch}) {
+    if (!s->empty() && s->compare(0, 4, "udp:") != 0) *s = indexed_path(*s, units_.size());
+  }
+  const uint16_t ch = u->cfg.stereo ? 2 : 1;
+  u->audio.reset(new AudioBroadcast(size_t(u->cfg.audio_rate_hz) * 10 * ch, ch, u->cfg.huge_pages));
+  if (!u->audio->init()) return false;
+  u->wav_in = &u->audio->add_reader("wav");
+  u->rx.reset(new FMReceiver(u->cfg, *u->audio));
+  units_.push_back(std::move(u));
+  return true;
+}
+
+bool ReceiverSet::start() {
+  if (running_) return true;
+  for (size_t i = 0; i < units_.size(); ++i) {
+    Unit& u = *units_[i];
+    const uint16_t ch = u.cfg.stereo ? 2 : 1;
+    if (u.cfg.write_wav && !u.wav.open(u.cfg.wav_path, uint32_t(u.cfg.audio_rate_hz), ch)) {
+      log_msg(LogLevel::Error, "RX %zu: WAV open failed", i);
+    } else if (u.rx->start()) {
+      continue;
+    } else {
+      log_msg(LogLevel::Error, "RX %zu (%s) start failed", i, u.rx->source_label().c_str());
+    }
+    // roll back the ones already running
+    u.wav.close();
+    for (size_t j = 0; j < i; ++j) {
+      units_[j]->rx->stop();
+      units_[j]->wav.close();
+    }
+    return false;
+  }
+  running_ = true;
+  for (auto& u : units_) u->drain = std::thread(&ReceiverSet::drain, this, std::ref(*u));
+  log_msg(LogLevel::Info, "%zu receivers running", units_.size());
+  return true;
+}
+
+void ReceiverSet::stop() {
+  if (!running_) return;
+  for (auto& u : units_) u->rx->stop();
+  running_ = false;
+  for (auto& u : units_) {
+    u->audio->stop();
+    if (u->drain.joinable()) u->drain.join();
+    u->wav.close();
+  }
+}
+
+void ReceiverSet::drain(Unit& u) {
+  const uint16_t ch = u.audio->channels();
+  std::vector<int16_t> pcm(size_t(u.cfg.audio_rate_hz) / 2);
+  while (true) {
+    uint64_t t_ns = 0;
+    size_t n = u.wav_in->pop_for(pcm.data(), pcm.size(), t_ns, 200);
+    if (n == 0) {
+      // after stop(), keep going until the tail the pipeline flushed is written
+      if (!running_) break;
+      continue;
+    }
+    if (u.cfg.write_wav) u.wav.write_i16(pcm.data(), n / ch);
+    u.samples += n;
+  }
+}
+
+ReceiverSetStats ReceiverSet::stats() const {
+  ReceiverSetStats s;
+  s.receivers = units_.size();
+  for (const auto& u : units_) {
+    s.worst_tier = std::max(s.worst_tier, u->rx->quality_tier());
+    s.worst_rtf = std::max(s.worst_rtf, u->rx->rtf());
+    s.iq_overruns += u->rx->iq_overruns();
+    s.squelched_blocks += u->rx->squelched_blocks();
+    s.audio_samples += u->samples;
+  }
+  return s;
+}
@@ -0,0 +1,227 @@
+#include "RtpSink.h"
+#include "Logging.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr size_t RTP_HDR = 12;
+static constexpr size_t MAX_PAYLOAD = 1460; // 1500 MTU - IP - UDP - RTP
+
+static bool parse_dest(const std::string& s, sockaddr_in& out) {
+  auto colon = s.rfind(':');
+  if (colon == std::string::npos) return false;
+  std::string host = s.substr(0, colon);
+  int port = std::atoi(s.c_str() + colon + 1);
+  if (port <= 0 || port > 65535) return false;
+
+  addrinfo hints{};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+  addrinfo* res = nullptr;
+  if (getaddrinfo(host.c_str(), nullptr, &hints, &res) != 0 || !res) return false;
+  std::memcpy(&out, res->ai_addr, sizeof(sockaddr_in));
+  freeaddrinfo(res);
+  out.sin_port = htons(uint16_t(port));
+  return true;
+}
+
+RtpSink::RtpSink(AudioReader& in, uint32_t sample_rate, uint16_t channels)
+  : in_(in), sample_rate_(sample_rate), channels_(channels) {
+  std::random_device rd;
+  ssrc_ = rd();
+  seq_ = uint16_t(rd());
+  ts_ = rd();
+}
+
+RtpSink::~RtpSink() { close(); }
+
+bool RtpSink::open(const std::vector<std::string>& dests, double packet_ms,
+                   uint8_t payload_type, int multicast_ttl) {
+  close();
+  if (dests.empty()) return false;
+
+  dests_.clear();
+  bool any_mcast = false;
+  for (const auto& d : dests) {
+    sockaddr_in a{};
+    if (!parse_dest(d, a)) {
+      log_msg(LogLevel::Error, "RTP: bad destination '%s' (want host:port)", d.c_str());
+      return false;
+    }
+    if (IN_MULTICAST(ntohl(a.sin_addr.s_addr))) any_mcast = true;
+    dests_.push_back(a);
+  }
+
+  size_t bytes_per_frame = size_t(channels_) * 2;
+  size_t frames = size_t(double(sample_rate_) * packet_ms / 1000.0 + 0.5);
+  size_t max_frames = MAX_PAYLOAD / bytes_per_frame;
+  frames_per_packet_ = std::max<size_t>(1, std::min(frames, max_frames));
+  if (frames_per_packet_ != frames) {
+    log_msg(LogLevel::Warn, "RTP: packet time clamped to %.2f ms",
+            1000.0 * double(frames_per_packet_) / double(sample_rate_));
+  }
+
+  pt_ = payload_type & 0x7F;
+  pkts_.assign(batch_ * (RTP_HDR + frames_per_packet_ * bytes_per_frame), 0);
+
+  fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd_ < 0) {
+    log_msg(LogLevel::Error, "RTP: socket failed: %s", std::strerror(errno));
+    return false;
+  }
+  if (any_mcast) {
+    unsigned char ttl = (unsigned char)std::max(0, std::min(255, multicast_ttl));
+    unsigned char loop = 1;
+    setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+  }
+
+  log_msg(LogLevel::Info, "RTP: %zu destination(s), %zu frames/packet (%.2f ms), PT=%u",
+          dests_.size(), frames_per_packet_,
+          1000.0 * double(frames_per_packet_) / double(sample_rate_), unsigned(pt_));
+  return true;
+}
+
+void RtpSink::set_paced(double target_fill_ms) {
+  adapt_.reset(new AdaptiveResampler(in_, double(sample_rate_), target_fill_ms));
+}
+
+bool RtpSink::start() {
+  if (fd_ < 0 || running_) return false;
+  running_ = true;
+  th_ = std::thread(adapt_ ? &RtpSink::worker_paced : &RtpSink::worker, this);
+  return true;
+}
+
+void RtpSink::stop() {
+  if (!running_) return;
+  running_ = false;
+  in_.stop();
+  if (th_.joinable()) th_.join();
+}
+
+void RtpSink::close() {
+  stop();
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+void RtpSink::build_packet(const int16_t* pcm, uint8_t* pkt) {
+  pkt[0] = 0x80; // V=2
+  pkt[1] = pt_;
+  pkt[2] = uint8_t(seq_ >> 8);
+  pkt[3] = uint8_t(seq_ & 0xFF);
+  pkt[4] = uint8_t(ts_ >> 24);
+  pkt[5] = uint8_t((ts_ >> 16) & 0xFF);
+  pkt[6] = uint8_t((ts_ >> 8) & 0xFF);
+  pkt[7] = uint8_t(ts_ & 0xFF);
+  pkt[8] = uint8_t(ssrc_ >> 24);
+  pkt[9] = uint8_t((ssrc_ >> 16) & 0xFF);
+  pkt[10] = uint8_t((ssrc_ >> 8) & 0xFF);
+  pkt[11] = uint8_t(ssrc_ & 0xFF);
+
+  // L16 is network byte order
+  uint8_t* p = pkt + RTP_HDR;
+  size_t n = frames_per_packet_ * channels_;
+  for (size_t i = 0; i < n; ++i) {
+    uint16_t v = uint16_t(pcm[i]);
+    p[2*i] = uint8_t(v >> 8);
+    p[2*i + 1] = uint8_t(v & 0xFF);
+  }
+
+  seq_++;
+  ts_ += uint32_t(frames_per_packet_);
+}
+
+void RtpSink::flush(size_t n_packets) {
+  size_t pkt_bytes = RTP_HDR + frames_per_packet_ * channels_ * 2;
+  size_t n_msgs = n_packets * dests_.size();
+
+  std::vector<iovec> iov(n_msgs);
+  std::vector<mmsghdr> msgs(n_msgs);
+  for (size_t p = 0; p < n_packets; ++p) {
+    for (size_t d = 0; d < dests_.size(); ++d) {
+      size_t k = p * dests_.size() + d;
+      iov[k].iov_base = pkts_.data() + p * pkt_bytes;
+      iov[k].iov_len = pkt_bytes;
+      std::memset(&msgs[k], 0, sizeof(mmsghdr));
+      msgs[k].msg_hdr.msg_name = &dests_[d];
+      msgs[k].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+      msgs[k].msg_hdr.msg_iov = &iov[k];
+      msgs[k].msg_hdr.msg_iovlen = 1;
+    }
+  }
+
+  size_t sent = 0;
+  while (sent < n_msgs) {
+    int r = sendmmsg(fd_, msgs.data() + sent, unsigned(n_msgs - sent), 0);
+    if (r < 0) {
+      if (errno == EINTR) continue;
+      // skip the failing datagram (e.g. ECONNREFUSED from a closed port) and carry on
+      send_errors_++;
+      sent++;
+      continue;
+    }
+    sent += size_t(r);
+  }
+  packets_sent_ += n_packets;
+}
+
+void RtpSink::worker() {
+  if (!policy_.empty()) apply_thread_policy("rtp", policy_);
+  size_t spp = frames_per_packet_ * channels_;
+  size_t pkt_bytes = RTP_HDR + spp * 2;
+  std::vector<int16_t> acc(batch_ * spp);
+  size_t have = 0;
+
+  while (running_) {
+    // Pop whatever is ready; a packet leaves as soon as it is full, so the
+    // sink adds at most one packet time. Backlog is sent as one batch.
+    uint64_t t_ns = 0;
+    size_t n = in_.pop(acc.data() + have, acc.size() - have, t_ns);
+    if (n == 0) break;
+    have += n;
+
+    size_t n_packets = have / spp;
+    if (n_packets == 0) continue;
+    for (size_t p = 0; p < n_packets; ++p) {
+      build_packet(acc.data() + p * spp, pkts_.data() + p * pkt_bytes);
+    }
+    flush(n_packets);
+    latency_.record(t_ns, mono_ns());
+
+    size_t used = n_packets * spp;
+    std::copy(acc.begin() + used, acc.begin() + have, acc.begin());
+    have -= used;
+  }
+}
+
+void RtpSink::worker_paced() {
+  if (!policy_.empty()) apply_thread_policy("rtp", policy_);
+  size_t spp = frames_per_packet_ * channels_;
+  std::vector<int16_t> pcm(spp);
+  auto period = std::chrono::nanoseconds(int64_t(1e9 * double(frames_per_packet_) / double(sample_rate_)));
+
+  if (!adapt_->prime()) return;
+  log_msg(LogLevel::Info, "RTP: paced output started, fill %.1f ms", adapt_->fill_ms());
+
+  auto next = std::chrono::steady_clock::now();
+  while (running_) {
+    std::this_thread::sleep_until(next);
+    next += period;
+
+    uint64_t t_ns = 0;
+    if (adapt_->pull(pcm.data(), frames_per_packet_, t_ns) < frames_per_packet_) break;
+    build_packet(pcm.data(), pkts_.data());
+    flush(1);
+    latency_.record(t_ns, mono_ns());
+  }
+}
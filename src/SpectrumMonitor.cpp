@@ -0,0 +1,207 @@
+#include "SpectrumMonitor.h"
+#include "LatencyStats.h"
+#include "Logging.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr size_t FRAME_HDR_BYTES = 48;
+static constexpr uint16_t VERSION = 1;
+static constexpr float DB_MIN = -127.5f;
+static constexpr float DB_STEP = 0.5f;
+static constexpr int MAX_LEVEL = 24;
+
+static void put_u16(uint8_t* p, uint16_t v) {
+  p[0] = uint8_t(v);
+  p[1] = uint8_t(v >> 8);
+}
+static void put_u32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; ++i) p[i] = uint8_t(v >> (8 * i));
+}
+static void put_u64(uint8_t* p, uint64_t v) {
+  for (int i = 0; i < 8; ++i) p[i] = uint8_t(v >> (8 * i));
+}
+static void put_f64(uint8_t* p, double v) {
+  uint64_t u;
+  std::memcpy(&u, &v, 8);
+  put_u64(p, u);
+}
+static void put_f32(uint8_t* p, float v) {
+  uint32_t u;
+  std::memcpy(&u, &v, 4);
+  put_u32(p, u);
+}
+
+SpectrumMonitor::SpectrumMonitor(SpectrumSource src, double fs_hz, const SpectrumSettings& s)
+  : src_(src), fs_(fs_hz), s_(s), fft_(s.fft_n), win_(blackman_harris(s.fft_n)),
+    buf_(s.fft_n), acc_(s.fft_n, 0.0f), frame_(FRAME_HDR_BYTES + s.fft_n) {
+  double sum = 0.0;
+  for (float w : win_) sum += w;
+  norm_ = float(1.0 / (sum * sum));
+  s_.avg = std::max(1, s_.avg);
+  set_level(0);
+}
+
+SpectrumMonitor::~SpectrumMonitor() { close(); }
+
+bool SpectrumMonitor::open(const std::string& dest) {
+  close();
+  if (dest.compare(0, 4, "udp:") == 0) {
+    size_t colon = dest.rfind(':');
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    int port = colon > 4 ? std::atoi(dest.c_str() + colon + 1) : 0;
+    std::string host = colon > 4 ? dest.substr(4, colon - 4) : "";
+    if (port <= 0 || port > 65535 || inet_pton(AF_INET, host.c_str(), &a.sin_addr) != 1) {
+      log_msg(LogLevel::Error, "Spectrum: bad destination '%s' (want udp:<IPv4>:<port>)", dest.c_str());
+      return false;
+    }
+    a.sin_port = htons(uint16_t(port));
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0 || connect(fd_, reinterpret_cast<sockaddr*>(&a), sizeof(a)) != 0) {
+      log_msg(LogLevel::Error, "Spectrum: socket to %s failed (%s)", dest.c_str(), std::strerror(errno));
+      close();
+      return false;
+    }
+  } else {
+    f_ = std::fopen(dest.c_str(), "wb");
+    if (!f_) {
+      log_msg(LogLevel::Error, "Spectrum: cannot create %s", dest.c_str());
+      return false;
+    }
+  }
+  log_msg(LogLevel::Info, "Spectrum (%s): %zu bins at %.0f Hz, %.1f frames/s -> %s",
+          src_ == SpectrumSource::Wideband ? "wideband" : "channel", s_.fft_n, fs_, s_.rate_hz, dest.c_str());
+  return true;
+}
+
+void SpectrumMonitor::close() {
+  if (f_) {
+    std::fclose(f_);
+    f_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+void SpectrumMonitor::set_level(int level) {
+  // each level halves the FFTs per frame, then, at one, the frame rate
+  level_ = level;
+  int avg = s_.avg;
+  double per_frame = fs_ / std::max(0.01, s_.rate_hz);
+  for (int i = 0; i < level; ++i) {
+    if (avg > 1) avg /= 2;
+    else per_frame *= 2.0;
+  }
+  avg_now_ = avg;
+  frame_s_ = per_frame / fs_;
+  hop_ = std::max(s_.fft_n, size_t(per_frame) / size_t(avg));
+}
+
+void SpectrumMonitor::reset() {
+  std::fill(acc_.begin(), acc_.end(), 0.0f);
+  fill_ = 0;
+  skip_ = 0;
+  count_ = 0;
+}
+
+void SpectrumMonitor::process(ConstSplitIQView x, uint64_t t_ns, double center_hz) {
+  uint64_t t0 = mono_ns();
+  const size_t n_fft = s_.fft_n;
+  size_t k = 0;
+  while (k < x.n) {
+    if (fill_ == 0 && skip_ > 0) {
+      size_t s = std::min(skip_, x.n - k);
+      skip_ -= s;
+      k += s;
+      continue;
+    }
+    size_t take = std::min(n_fft - fill_, x.n - k);
+    for (size_t j = 0; j < take; ++j) {
+      float w = win_[fill_ + j];
+      buf_[fill_ + j] = std::complex<float>(x.i[k + j] * w, x.q[k + j] * w);
+    }
+    fill_ += take;
+    k += take;
+    if (fill_ < n_fft) break;
+
+    fft_.forward(buf_.data());
+    for (size_t b = 0; b < n_fft; ++b) acc_[b] += std::norm(buf_[b]);
+    fill_ = 0;
+    skip_ = hop_ - n_fft;
+    if (++count_ >= avg_now_) {
+      busy_ns_ += mono_ns() - t0;
+      emit(t_ns, center_hz);
+      t0 = mono_ns();
+    }
+  }
+  busy_ns_ += mono_ns() - t0;
+}
+
+void SpectrumMonitor::emit(uint64_t t_ns, double center_hz) {
+  const size_t n_fft = s_.fft_n;
+  uint8_t* h = frame_.data();
+  std::memcpy(h, "FMSP", 4);
+  put_u16(h + 4, VERSION);
+  put_u16(h + 6, uint16_t(n_fft));
+  h[8] = uint8_t(src_);
+  h[9] = 0;
+  put_u16(h + 10, uint16_t(count_));
+  put_u32(h + 12, seq_);
+  put_f64(h + 16, fs_);
+  put_f64(h + 24, center_hz);
+  // capture time on the wall clock: now minus the age of the chunk
+  uint64_t now_mono = mono_ns();
+  auto wall = std::chrono::system_clock::now().time_since_epoch();
+  uint64_t unix_ns = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(wall).count());
+  if (t_ns != 0 && now_mono > t_ns) unix_ns -= now_mono - t_ns;
+  put_u64(h + 32, unix_ns);
+  put_f32(h + 40, DB_MIN);
+  put_f32(h + 44, DB_STEP);
+
+  // FFT order is DC first; shift so the lowest frequency comes first
+  uint8_t* row = h + FRAME_HDR_BYTES;
+  float scale = norm_ / float(count_);
+  for (size_t b = 0; b < n_fft; ++b) {
+    float p = acc_[(b + n_fft / 2) % n_fft] * scale;
+    float db = 10.0f * std::log10(p + 1e-20f);
+    float v = std::round((db - DB_MIN) / DB_STEP);
+    row[b] = uint8_t(std::max(0.0f, std::min(255.0f, v)));
+  }
+
+  if (f_) {
+    std::fwrite(frame_.data(), 1, frame_.size(), f_);
+    std::fflush(f_);
+  } else if (fd_ >= 0) {
+    // nobody listening is fine; never wait on the socket
+    (void)send(fd_, frame_.data(), frame_.size(), MSG_DONTWAIT);
+  }
+  seq_++;
+  std::fill(acc_.begin(), acc_.end(), 0.0f);
+  count_ = 0;
+
+  // Hold analysis within budget (share of wall time since the last frame):
+  // step down when over, back up once well under.
+  uint64_t now = mono_ns();
+  if (last_frame_ns_ != 0 && now > last_frame_ns_) {
+    double load = double(busy_ns_) / double(now - last_frame_ns_);
+    if (load > s_.budget && level_ < MAX_LEVEL) {
+      set_level(level_ + 1);
+      log_msg(LogLevel::Debug, "Spectrum: %.1f%% CPU, %d FFTs per frame, %.2f frames/s",
+              load * 100.0, avg_now_.load(), 1.0 / frame_s_);
+    } else if (load < s_.budget / 4 && level_ > 0) {
+      set_level(level_ - 1);
+    }
+  }
+  last_frame_ns_ = now;
+  busy_ns_ = 0;
+}
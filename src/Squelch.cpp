@@ -0,0 +1,60 @@
+#include "Squelch.h"
+#include <algorithm>
+#include <cmath>
+
+static constexpr double TAU_S = 0.02;
+// Flatness: noise is 2, a carrier at ~6 dB SNR about 1.4
+static constexpr float FLAT_OPEN = 1.45f;
+static constexpr float FLAT_CLOSE = 1.65f;
+
+Squelch::Squelch(float open_db, float hyst_db, double hang_s)
+  : open_db_(open_db), close_db_(open_db - std::max(0.0f, hyst_db)), hang_s_(hang_s) {}
+
+void Squelch::reset() {
+  open_ = false;
+  primed_ = false;
+  power_db_ = -200.0f;
+  flat_ = 2.0f;
+  below_s_ = 0.0;
+}
+
+void Squelch::remeasure() {
+  primed_ = false;
+  below_s_ = 0.0;
+}
+
+bool Squelch::update(ConstSplitIQView x, double block_s) {
+  if (x.n == 0) return false;
+  double p = 0.0, p2 = 0.0;
+  for (size_t i = 0; i < x.n; ++i) {
+    float e = x.i[i] * x.i[i] + x.q[i] * x.q[i];
+    p += e;
+    p2 += double(e) * e;
+  }
+  p /= double(x.n);
+  p2 /= double(x.n);
+  float db = float(10.0 * std::log10(p + 1e-20));
+  float flat = (p > 0.0) ? float(p2 / (p * p)) : 2.0f;
+
+  if (!primed_) {
+    power_db_ = db;
+    flat_ = flat;
+    primed_ = true;
+  } else {
+    float a = float(1.0 - std::exp(-block_s / TAU_S));
+    power_db_ += a * (db - power_db_);
+    flat_ += a * (flat - flat_);
+  }
+
+  bool was = open_;
+  if (!open_) {
+    if (power_db_ >= open_db_ && flat_ <= FLAT_OPEN) {
+      open_ = true;
+      below_s_ = 0.0;
+    }
+  } else {
+    below_s_ = (power_db_ < close_db_ || flat_ > FLAT_CLOSE) ? below_s_ + block_s : 0.0;
+    if (below_s_ >= hang_s_) open_ = false;
+  }
+  return open_ != was;
+}
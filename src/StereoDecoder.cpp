@@ -0,0 +1,157 @@
+#include "StereoDecoder.h"
+#include "dsp/FirDesign.h"
+#include "Logging.h"
+#include <algorithm>
+#include <cmath>
+
+// Inputs per pass; small enough that both channels' scratch stays in L1.
+static constexpr size_t CHUNK = 256;
+static constexpr uint32_t MAX_INTERP = 256;
+static constexpr int NTAPS = 161;
+static constexpr int RATIONAL_TAPS_PER_PHASE = 128;
+
+static constexpr double PILOT_HZ = 19000.0;
+static constexpr double PLL_BW_HZ = 10.0;
+static constexpr double PLL_PULL_HZ = 50.0;
+static constexpr double PILOT_TAU_S = 0.02;
+static constexpr float LOCK_ON = 0.35f;    // pilot level to switch to stereo
+static constexpr float LOCK_OFF = 0.2f;    // and back to mono
+static constexpr double BLEND_S = 0.05;
+
+StereoDecoder::StereoDecoder(double fs_in, double fs_out, float deemph_tau_s, float audio_cut_hz)
+  : fs_in_(fs_in), fs_out_(fs_out) {
+
+  double w0 = 2.0 * M_PI * PILOT_HZ / fs_in_;
+  cb_ = float(std::cos(w0));
+  sb_ = float(std::sin(w0));
+
+  // 2nd order loop, damping 0.707
+  double wn = 2.0 * M_PI * PLL_BW_HZ / fs_in_;
+  alpha_ = float(2.0 * 0.707 * wn);
+  beta_ = float(wn * wn);
+  max_freq_ = float(2.0 * M_PI * PLL_PULL_HZ / fs_in_);
+  k_amp_ = float(1.0 - std::exp(-1.0 / (fs_in_ * PILOT_TAU_S)));
+  // pilot is 9% of 75 kHz deviation; the discriminator outputs rad/sample
+  nominal_ = float(2.0 * M_PI * 0.09 * 75000.0 / fs_in_);
+  scale_ = float(fs_in_ / (2.0 * M_PI * 75000.0));
+
+  // keep the pilot out of L+R
+  float cut = std::min({audio_cut_hz, 15000.0f, float(0.45 * fs_out_)});
+
+  uint32_t L = 1, M = 1;
+  bool exact = rational_approx(fs_out_ / fs_in_, 1u << 20, L, M);
+  if (!exact || L > MAX_INTERP) {
+    L = 1;
+    M = std::max<uint32_t>(1, uint32_t(fs_in_ / (2.0 * fs_out_)));
+    use_farrow_ = true;
+    double r = fs_out_ / (fs_in_ / double(M));
+    far_s_ = FarrowResamplerR(r);
+    far_d_ = FarrowResamplerR(r);
+  }
+  rs_ = RationalResamplerR2(design_lowpass(float(fs_in_ * L), cut,
+                                            (L == 1) ? NTAPS : int(L) * RATIONAL_TAPS_PER_PHASE), L, M);
+
+  a_ = float(1.0 - std::exp(-1.0 / (fs_out_ * double(deemph_tau_s))));
+  blend_step_ = float(1.0 / (BLEND_S * fs_out_));
+
+  s_buf_.resize(CHUNK); d_buf_.resize(CHUNK);
+  s_mid_.resize(CHUNK + 2); d_mid_.resize(CHUNK + 2);
+  size_t out_max = size_t(double(CHUNK) * fs_out_ / fs_in_) + 4;
+  s_out_.resize(out_max); d_out_.resize(out_max);
+
+  log_msg(LogLevel::Info, "StereoDecoder: %.3f -> %.0f Hz, polyphase %u/%u%s",
+          fs_in_, fs_out_, L, M, use_farrow_ ? " + Farrow" : "");
+}
+
+void StereoDecoder::reset() {
+  c_ = 1.0f; s_ = 0.0f;
+  freq_ = 0.0f;
+  pi_ = pq_ = 0.0f;
+  rs_.reset();
+  far_s_.reset();
+  far_d_.reset();
+  yl_ = yr_ = 0.0f;
+  blend_ = 0.0f;
+  locked_ = false;
+  pilot_level_ = 0.0f;
+}
+
+size_t StereoDecoder::mix_chunk(const float* in, size_t n) {
+  float c = c_, s = s_, freq = freq_, pi = pi_, pq = pq_;
+  const float floor_amp = 0.25f * nominal_ * 0.5f;
+
+  for (size_t i = 0; i < n; ++i) {
+    float x = in[i];
+
+    // phase detector and pilot arms
+    float e = x * c;
+    pi += k_amp_ * (x * s - pi);
+    pq += k_amp_ * (e - pq);
+    float en = e / std::max(pi, floor_amp);
+
+    // L+R as is; L-R demodulated against sin(2*theta)
+    s_buf_[i] = x;
+    d_buf_[i] = 4.0f * x * s * c;
+
+    // loop filter and NCO step: nominal rotation, then small correction
+    freq = std::max(-max_freq_, std::min(max_freq_, freq + beta_ * en));
+    float d = freq + alpha_ * en;
+    float c1 = c * cb_ - s * sb_;
+    float s1 = s * cb_ + c * sb_;
+    float cd = 1.0f - 0.5f * d * d;
+    c = c1 * cd - s1 * d;
+    s = s1 * cd + c1 * d;
+  }
+
+  // the recursive rotation drifts in magnitude; renormalize per chunk
+  float r = 1.0f / std::sqrt(c * c + s * s);
+  c_ = c * r; s_ = s * r;
+  freq_ = freq; pi_ = pi; pq_ = pq;
+
+  float level = 2.0f * pi / nominal_;
+  pilot_level_ = level;
+  bool in_phase = std::fabs(pq) < 0.5f * std::fabs(pi);
+  if (!locked_ && level > LOCK_ON && in_phase) locked_ = true;
+  else if (locked_ && (level < LOCK_OFF || !in_phase)) locked_ = false;
+
+  size_t n_mid = rs_.process(s_buf_.data(), d_buf_.data(), n,
+                             s_mid_.data(), d_mid_.data(), s_mid_.size());
+  if (!use_farrow_) {
+    std::copy(s_mid_.begin(), s_mid_.begin() + n_mid, s_out_.begin());
+    std::copy(d_mid_.begin(), d_mid_.begin() + n_mid, d_out_.begin());
+    return n_mid;
+  }
+  size_t n_s = far_s_.process(s_mid_.data(), n_mid, s_out_.data(), s_out_.size());
+  far_d_.process(d_mid_.data(), n_mid, d_out_.data(), d_out_.size());
+  return n_s;
+}
+
+size_t StereoDecoder::process(const float* in_mpx, size_t n_in,
+                              int16_t* out_lr, size_t out_frames_cap) {
+  size_t out_n = 0;
+  for (size_t off = 0; off < n_in; off += CHUNK) {
+    size_t n = std::min(CHUNK, n_in - off);
+    size_t m = mix_chunk(in_mpx + off, n);
+
+    const float target = locked_ ? 1.0f : 0.0f;
+    for (size_t i = 0; i < m && out_n < out_frames_cap; ++i) {
+      if (blend_ < target) blend_ = std::min(target, blend_ + blend_step_);
+      else if (blend_ > target) blend_ = std::max(target, blend_ - blend_step_);
+
+      float sum = s_out_[i];
+      float diff = d_out_[i] * blend_;
+      yl_ += a_ * ((sum + diff) - yl_);
+      yr_ += a_ * ((sum - diff) - yr_);
+
+      float l = std::max(-1.0f, std::min(1.0f, yl_ * scale_ * gain_));
+      float r = std::max(-1.0f, std::min(1.0f, yr_ * scale_ * gain_));
+      out_lr[2*out_n] = int16_t(std::lrintf(l * 32767.0f));
+      out_lr[2*out_n + 1] = int16_t(std::lrintf(r * 32767.0f));
+      out_n++;
+    }
+  }
+  return out_n;
+}
+
+double StereoDecoder::fs_out() const { return fs_out_; }
+void StereoDecoder::set_audio_gain(float g) { gain_ = g; }
@@ -0,0 +1,42 @@
+#include "dsp/FFT.h"
+#include <cmath>
+#include <utility>
+
+FFT::FFT(size_t n) : n_(n), tw_(n / 2), rev_(n) {
+  for (size_t k = 0; k < n_ / 2; ++k) {
+    tw_[k] = std::complex<float>(std::polar(1.0, -2.0 * M_PI * double(k) / double(n_)));
+  }
+  size_t bits = 0;
+  while ((size_t(1) << bits) < n_) ++bits;
+  for (size_t i = 0; i < n_; ++i) {
+    size_t r = 0;
+    for (size_t b = 0; b < bits; ++b) if (i & (size_t(1) << b)) r |= size_t(1) << (bits - 1 - b);
+    rev_[i] = r;
+  }
+}
+
+void FFT::forward(std::complex<float>* x) const {
+  for (size_t i = 0; i < n_; ++i) {
+    if (i < rev_[i]) std::swap(x[i], x[rev_[i]]);
+  }
+  for (size_t len = 2; len <= n_; len <<= 1) {
+    size_t half = len / 2;
+    size_t step = n_ / len;
+    for (size_t i = 0; i < n_; i += len) {
+      for (size_t k = 0; k < half; ++k) {
+        std::complex<float> t = x[i + k + half] * tw_[k * step];
+        x[i + k + half] = x[i + k] - t;
+        x[i + k] += t;
+      }
+    }
+  }
+}
+
+std::vector<float> blackman_harris(size_t n) {
+  std::vector<float> w(n);
+  for (size_t i = 0; i < n; ++i) {
+    double a = 2.0 * M_PI * double(i) / double(n - 1);
+    w[i] = float(0.35875 - 0.48829 * std::cos(a) + 0.14128 * std::cos(2 * a) - 0.01168 * std::cos(3 * a));
+  }
+  return w;
+}
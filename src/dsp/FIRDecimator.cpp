@@ -1,40 +1,162 @@
 #include "dsp/FIRDecimator.h"
 #include <algorithm>
+#include <cmath>
+
+// Inputs per pass through the linear history.
+static constexpr size_t CHUNK = 2048;
+// Reverse the taps so each output is a straight multiply-add over
+// contiguous history.
+static size_t prepare_taps(const std::vector<float>& taps, AlignedFloats& out) {
+  out.assign(taps.rbegin(), taps.rend());
+  return out.size();
+}
+
+// The reductions need reassociation to vectorize; omp simd grants it for
+// these loops only (CMake passes -fopenmp-simd, no OpenMP runtime).
+static inline void dot2(const float* t, const float* xi, const float* xq, size_t nt,
+                        float& acc_i, float& acc_q) {
+  float a = 0.0f, b = 0.0f;
+#pragma omp simd reduction(+:a,b)
+  for (size_t m = 0; m < nt; ++m) {
+    a += t[m] * xi[m];
+    b += t[m] * xq[m];
+  }
+  acc_i = a;
+  acc_q = b;
+}
+
+// Complex taps (tr + j*ti) against split history.
+static inline void cdot(const float* tr, const float* ti, const float* xi, const float* xq, size_t nt,
+                        float& acc_i, float& acc_q) {
+  float a = 0.0f, b = 0.0f;
+#pragma omp simd reduction(+:a,b)
+  for (size_t m = 0; m < nt; ++m) {
+    a += tr[m] * xi[m] - ti[m] * xq[m];
+    b += tr[m] * xq[m] + ti[m] * xi[m];
+  }
+  acc_i = a;
+  acc_q = b;
+}
+
+// Shared chunk loop: copy a chunk behind the history, emit every decim-th
+// output via kernel(xi, xq, acc_i, acc_q), then keep the last nt-1 inputs.
+template <class Kernel>
+static size_t run_chunks(ConstSplitIQView in, SplitIQView out, size_t nt, uint32_t decim,
+                         uint32_t& phase, AlignedFloats& hi, AlignedFloats& hq, Kernel kernel) {
+  size_t out_n = 0;
+  const size_t keep = nt - 1;
+  for (size_t off = 0; off < in.n; off += CHUNK) {
+    size_t c = std::min(CHUNK, in.n - off);
+    std::copy(in.i + off, in.i + off + c, hi.begin() + keep);
+    std::copy(in.q + off, in.q + off + c, hq.begin() + keep);
+
+    // input j of this chunk produces an output when (phase + j) % decim == 0
+    for (size_t j = (decim - phase) % decim; j < c && out_n < out.n; j += decim) {
+      kernel(hi.data() + j, hq.data() + j, out.i[out_n], out.q[out_n]);
+      out_n++;
+    }
+    phase = uint32_t((phase + c) % decim);
+
+    std::copy(hi.begin() + c, hi.begin() + c + keep, hi.begin());
+    std::copy(hq.begin() + c, hq.begin() + c + keep, hq.begin());
+  }
+  return out_n;
+}
+
+// Interleaved entry points go through split scratch sized on demand.
+static void ensure(SplitIQBuffer& b, size_t n) {
+  if (b.size() < n) b.resize(n);
+}
 
 FIRDecimatorC::FIRDecimatorC(const std::vector<float>& taps, uint32_t decim)
-  : taps_(taps), delay_(taps.size()), decim_(decim), phase_(0) {}
+  : decim_(decim), phase_(0) {
+  nt_ = prepare_taps(taps, taps_);
+  hi_.assign(nt_ - 1 + CHUNK, 0.0f);
+  hq_.assign(nt_ - 1 + CHUNK, 0.0f);
+}
 
 void FIRDecimatorC::reset() {
-  std::fill(delay_.begin(), delay_.end(), std::complex<float>(0,0));
-  di_ = 0;
+  std::fill(hi_.begin(), hi_.end(), 0.0f);
+  std::fill(hq_.begin(), hq_.end(), 0.0f);
   phase_ = 0;
 }
 
+size_t FIRDecimatorC::process(ConstSplitIQView in, SplitIQView out) {
+  const float* t = taps_.data();
+  const size_t nt = nt_;
+  return run_chunks(in, out, nt_, decim_, phase_, hi_, hq_,
+                    [t, nt](const float* xi, const float* xq, float& oi, float& oq) {
+                      dot2(t, xi, xq, nt, oi, oq);
+                    });
+}
+
 size_t FIRDecimatorC::process(const std::complex<float>* in, size_t n_in, std::complex<float>* out, size_t out_cap) {
-  size_t out_n = 0;
-  size_t nt = taps_.size();
-  for (size_t i = 0; i < n_in; ++i) {
-    delay_[di_] = in[i];
-    di_ = (di_ + 1) % nt;
+  ensure(sin_, n_in);
+  ensure(sout_, out_cap);
+  deinterleave(in, n_in, sin_.view());
+  size_t n = process(sin_.cview(n_in), sout_.view(0, out_cap));
+  interleave(sout_.cview(n), out);
+  return n;
+}
 
-    if (phase_ == 0) {
-      if (out_n >= out_cap) break;
-      std::complex<float> acc(0,0);
-      size_t idx = di_;
-      for (size_t k = 0; k < nt; ++k) {
-        idx = (idx == 0) ? (nt - 1) : (idx - 1);
-        acc += delay_[idx] * taps_[k];
-      }
-      out[out_n++] = acc;
+FIRDecimatorXlate::FIRDecimatorXlate(const std::vector<float>& taps, uint32_t decim, double fs, double offset_hz)
+  : decim_(decim), phase_(0) {
+  double w = 2.0 * M_PI * offset_hz / fs;
+  std::vector<float> re(taps.size()), im(taps.size());
+  for (size_t k = 0; k < taps.size(); ++k) {
+    std::complex<double> h = std::polar(double(taps[k]), w * double(k));
+    re[k] = float(h.real());
+    im[k] = float(h.imag());
+  }
+  nt_ = prepare_taps(re, tr_);
+  prepare_taps(im, ti_);
+  hi_.assign(nt_ - 1 + CHUNK, 0.0f);
+  hq_.assign(nt_ - 1 + CHUNK, 0.0f);
+
+  double wd = std::remainder(w * double(decim_), 2.0 * M_PI);
+  rotate_ = std::fabs(wd) > 1e-9;
+  rot_step_ = std::polar(1.0, -wd);
+}
+
+void FIRDecimatorXlate::reset() {
+  std::fill(hi_.begin(), hi_.end(), 0.0f);
+  std::fill(hq_.begin(), hq_.end(), 0.0f);
+  phase_ = 0;
+  rot_ = {1.0, 0.0};
+}
+
+size_t FIRDecimatorXlate::process(ConstSplitIQView in, SplitIQView out) {
+  const float* tr = tr_.data();
+  const float* ti = ti_.data();
+  const size_t nt = nt_;
+  size_t n = run_chunks(in, out, nt_, decim_, phase_, hi_, hq_,
+                        [tr, ti, nt](const float* xi, const float* xq, float& oi, float& oq) {
+                          cdot(tr, ti, xi, xq, nt, oi, oq);
+                        });
+  if (rotate_) {
+    for (size_t k = 0; k < n; ++k) {
+      std::complex<float> r(rot_);
+      float a = out.i[k], b = out.q[k];
+      out.i[k] = a * r.real() - b * r.imag();
+      out.q[k] = a * r.imag() + b * r.real();
+      rot_ *= rot_step_;
+      rot_ /= std::abs(rot_);
     }
-    phase_++;
-    if (phase_ >= decim_) phase_ = 0;
   }
-  return out_n;
+  return n;
+}
+
+size_t FIRDecimatorXlate::process(const std::complex<float>* in, size_t n_in, std::complex<float>* out, size_t out_cap) {
+  ensure(sin_, n_in);
+  ensure(sout_, out_cap);
+  deinterleave(in, n_in, sin_.view());
+  size_t n = process(sin_.cview(n_in), sout_.view(0, out_cap));
+  interleave(sout_.cview(n), out);
+  return n;
 }
 
 FIRDecimatorR::FIRDecimatorR(const std::vector<float>& taps, uint32_t decim)
-  : taps_(taps), delay_(taps.size()), decim_(decim), phase_(0) {}
+  : taps_(taps.begin(), taps.end()), delay_(taps.size()), decim_(decim), phase_(0) {}
 
 void FIRDecimatorR::reset() {
   std::fill(delay_.begin(), delay_.end(), 0.0f);
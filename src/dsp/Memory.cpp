@@ -0,0 +1,127 @@
+#include "dsp/Memory.h"
+#include "Logging.h"
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static constexpr size_t PAGE_4K = 4096;
+static constexpr size_t PAGE_2M = 2 * 1024 * 1024;
+static constexpr int MPOL_PREFERRED_ = 1;   // <numaif.h>, without linking libnuma
+
+static size_t round_up(size_t n, size_t a) { return (n + a - 1) & ~(a - 1); }
+
+MemRegion::MemRegion(MemRegion&& o) noexcept { *this = std::move(o); }
+
+MemRegion& MemRegion::operator=(MemRegion&& o) noexcept {
+  if (this != &o) {
+    unmap();
+    std::swap(p_, o.p_);
+    std::swap(size_, o.size_);
+    std::swap(base_, o.base_);
+    std::swap(base_len_, o.base_len_);
+    std::swap(hugetlb_, o.hugetlb_);
+  }
+  return *this;
+}
+
+bool MemRegion::map(size_t bytes, HugePages hp, int numa_node, const char* what) {
+  unmap();
+  if (bytes == 0) return false;
+
+  if (hp == HugePages::Explicit) {
+    size_t len = round_up(bytes, PAGE_2M);
+    void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+      base_ = p_ = p;
+      base_len_ = size_ = len;
+      hugetlb_ = true;
+    } else {
+      log_msg(LogLevel::Warn, "Memory: %s: explicit huge pages denied (%s), trying transparent",
+              what, std::strerror(errno));
+      hp = HugePages::Transparent;
+    }
+  }
+
+  if (!p_) {
+    // THP needs 2 MB aligned ranges: over-map and trim
+    size_t align = (hp == HugePages::Off) ? PAGE_4K : PAGE_2M;
+    size_t len = round_up(bytes, align);
+    size_t map_len = len + (align > PAGE_4K ? align : 0);
+    void* p = mmap(nullptr, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+      log_msg(LogLevel::Error, "Memory: %s: mmap of %zu bytes failed (%s)", what, map_len, std::strerror(errno));
+      return false;
+    }
+    uintptr_t a = round_up(uintptr_t(p), align);
+    size_t head = a - uintptr_t(p);
+    if (head) munmap(p, head);
+    if (map_len - head > len) munmap(reinterpret_cast<char*>(a) + len, map_len - head - len);
+    base_ = p_ = reinterpret_cast<void*>(a);
+    base_len_ = size_ = len;
+    if (hp == HugePages::Transparent && madvise(p_, size_, MADV_HUGEPAGE) != 0) {
+      log_msg(LogLevel::Warn, "Memory: %s: MADV_HUGEPAGE denied (%s)", what, std::strerror(errno));
+    }
+  }
+
+  if (numa_node >= 0 && numa_node < 64) {
+    unsigned long mask = 1ul << numa_node;
+    if (syscall(SYS_mbind, p_, size_, MPOL_PREFERRED_, &mask, 64, 0) != 0) {
+      log_msg(LogLevel::Warn, "Memory: %s: NUMA node %d denied (%s)", what, numa_node, std::strerror(errno));
+    }
+  }
+
+  log_msg(LogLevel::Info, "Memory: %s %zu KB, %s pages, node %s", what, size_ / 1024,
+          hugetlb_ ? "2 MB hugetlb" : (hp == HugePages::Transparent ? "transparent huge" : "4 KB"),
+          numa_node >= 0 ? std::to_string(numa_node).c_str() : "any");
+  return true;
+}
+
+void MemRegion::unmap() {
+  if (base_) munmap(base_, base_len_);
+  p_ = base_ = nullptr;
+  size_ = base_len_ = 0;
+  hugetlb_ = false;
+}
+
+bool Arena::reserve(size_t bytes, HugePages hp, int numa_node, const char* what) {
+  used_ = 0;
+  return mem_.map(bytes, hp, numa_node, what);
+}
+
+void* Arena::alloc(size_t bytes) {
+  size_t off = round_up(used_, SIMD_ALIGN);
+  if (!mem_.data() || off + bytes > mem_.size()) return nullptr;
+  used_ = off + bytes;
+  return static_cast<char*>(mem_.data()) + off;
+}
+
+int numa_node_of_cpu(int cpu) {
+  if (cpu < 0) return -1;
+  // more than one node online?
+  DIR* nodes = opendir("/sys/devices/system/node");
+  if (!nodes) return -1;
+  int count = 0;
+  while (dirent* e = readdir(nodes)) {
+    if (std::strncmp(e->d_name, "node", 4) == 0) count++;
+  }
+  closedir(nodes);
+  if (count < 2) return -1;
+
+  std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+  DIR* d = opendir(dir.c_str());
+  if (!d) return -1;
+  int node = -1;
+  while (dirent* e = readdir(d)) {
+    if (std::strncmp(e->d_name, "node", 4) == 0) {
+      node = std::atoi(e->d_name + 4);
+      break;
+    }
+  }
+  closedir(d);
+  return node;
+}
@@ -0,0 +1,159 @@
+#include "dsp/Resampler.h"
+#include <algorithm>
+#include <cmath>
+
+bool rational_approx(double x, uint32_t max_den, uint32_t& num, uint32_t& den) {
+  // continued fraction convergents
+  uint64_t p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+  double r = x;
+  for (int it = 0; it < 64; ++it) {
+    double a = std::floor(r);
+    uint64_t ai = uint64_t(a);
+    uint64_t p2 = ai * p1 + p0;
+    uint64_t q2 = ai * q1 + q0;
+    if (q2 > max_den) break;
+    p0 = p1; q0 = q1; p1 = p2; q1 = q2;
+    if (std::fabs(double(p1) / double(q1) - x) <= 1e-9 * x) break;
+    double f = r - a;
+    if (f < 1e-12) break;
+    r = 1.0 / f;
+  }
+  if (q1 == 0) return false;
+  num = uint32_t(p1);
+  den = uint32_t(q1);
+  return num > 0 && std::fabs(double(num) / double(den) - x) <= 1e-9 * x;
+}
+
+static size_t build_bank(const std::vector<float>& proto, uint32_t interp, AlignedFloats& bank) {
+  size_t ntaps = (proto.size() + interp - 1) / interp;
+  bank.assign(size_t(interp) * ntaps, 0.0f);
+  // phase p, tap k = proto[p + k*L] * L; stored reversed so the newest
+  // history sample meets the last tap
+  for (uint32_t p = 0; p < interp; ++p) {
+    for (size_t k = 0; k < ntaps; ++k) {
+      size_t idx = p + k * interp;
+      float h = (idx < proto.size()) ? proto[idx] * float(interp) : 0.0f;
+      bank[p * ntaps + (ntaps - 1 - k)] = h;
+    }
+  }
+  return ntaps;
+}
+
+RationalResamplerR::RationalResamplerR(const std::vector<float>& proto, uint32_t interp, uint32_t decim)
+  : interp_(interp), decim_(decim) {
+  ntaps_ = build_bank(proto, interp_, bank_);
+  hist_.assign(2 * ntaps_, 0.0f);
+}
+
+void RationalResamplerR::reset() {
+  std::fill(hist_.begin(), hist_.end(), 0.0f);
+  hi_ = 0;
+  phase_ = 0;
+}
+
+size_t RationalResamplerR::process(const float* in, size_t n_in, float* out, size_t out_cap) {
+  size_t out_n = 0;
+  for (size_t i = 0; i < n_in; ++i) {
+    // hist_[hi_ .. hi_+ntaps_) holds the last ntaps_ inputs, oldest first
+    hist_[hi_] = in[i];
+    hist_[hi_ + ntaps_] = in[i];
+    hi_ = (hi_ + 1) % ntaps_;
+
+    while (phase_ < interp_) {
+      if (out_n >= out_cap) return out_n;
+      const float* h = &bank_[size_t(phase_) * ntaps_];
+      const float* x = &hist_[hi_];
+      float acc = 0.0f;
+      for (size_t k = 0; k < ntaps_; ++k) acc += h[k] * x[k];
+      out[out_n++] = acc;
+      phase_ += decim_;
+    }
+    phase_ -= interp_;
+  }
+  return out_n;
+}
+
+RationalResamplerR2::RationalResamplerR2(const std::vector<float>& proto, uint32_t interp, uint32_t decim)
+  : interp_(interp), decim_(decim) {
+  ntaps_ = build_bank(proto, interp_, bank_);
+  hist_.assign(4 * ntaps_, 0.0f);
+}
+
+void RationalResamplerR2::reset() {
+  std::fill(hist_.begin(), hist_.end(), 0.0f);
+  hi_ = 0;
+  phase_ = 0;
+}
+
+size_t RationalResamplerR2::process(const float* in_a, const float* in_b, size_t n_in,
+                                    float* out_a, float* out_b, size_t out_cap) {
+  size_t out_n = 0;
+  for (size_t i = 0; i < n_in; ++i) {
+    size_t w = 2 * hi_, w2 = 2 * (hi_ + ntaps_);
+    hist_[w] = in_a[i]; hist_[w + 1] = in_b[i];
+    hist_[w2] = in_a[i]; hist_[w2 + 1] = in_b[i];
+    hi_ = (hi_ + 1) % ntaps_;
+
+    while (phase_ < interp_) {
+      if (out_n >= out_cap) return out_n;
+      const float* h = &bank_[size_t(phase_) * ntaps_];
+      const float* x = &hist_[2 * hi_];
+      float acc_a = 0.0f, acc_b = 0.0f;
+      for (size_t k = 0; k < ntaps_; ++k) {
+        acc_a += h[k] * x[2*k];
+        acc_b += h[k] * x[2*k + 1];
+      }
+      out_a[out_n] = acc_a;
+      out_b[out_n] = acc_b;
+      out_n++;
+      phase_ += decim_;
+    }
+    phase_ -= interp_;
+  }
+  return out_n;
+}
+
+FarrowResamplerR::FarrowResamplerR(double ratio_out_over_in) { set_ratio(ratio_out_over_in); }
+
+void FarrowResamplerR::reset() {
+  mu_ = 1.0;
+  std::fill(h_, h_ + 4, 0.0f);
+  std::fill(c_, c_ + 4, 0.0f);
+}
+
+void FarrowResamplerR::set_ratio(double ratio_out_over_in) {
+  if (ratio_out_over_in > 0.0) step_ = 1.0 / ratio_out_over_in;
+}
+
+void FarrowResamplerR::shift_in(float x) {
+  h_[0] = h_[1]; h_[1] = h_[2]; h_[2] = h_[3]; h_[3] = x;
+
+  // interpolate between h_[1] and h_[2]
+  c_[0] = h_[1];
+  c_[1] = -h_[0] / 3.0f - h_[1] / 2.0f + h_[2] - h_[3] / 6.0f;
+  c_[2] = (h_[0] + h_[2]) / 2.0f - h_[1];
+  c_[3] = (h_[3] - h_[0]) / 6.0f + (h_[1] - h_[2]) / 2.0f;
+}
+
+size_t FarrowResamplerR::process(const float* in, size_t n_in, float* out, size_t out_cap) {
+  size_t consumed = 0;
+  return process(in, n_in, consumed, out, out_cap);
+}
+
+size_t FarrowResamplerR::process(const float* in, size_t n_in, size_t& consumed, float* out, size_t out_cap) {
+  size_t out_n = 0;
+  size_t i = 0;
+  while (true) {
+    while (mu_ < 1.0) {
+      if (out_n >= out_cap) { consumed = i; return out_n; }
+      float m = float(mu_);
+      out[out_n++] = ((c_[3] * m + c_[2]) * m + c_[1]) * m + c_[0];
+      mu_ += step_;
+    }
+    if (i >= n_in) break;
+    mu_ -= 1.0;
+    shift_in(in[i++]);
+  }
+  consumed = i;
+  return out_n;
+}
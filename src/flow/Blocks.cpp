@@ -0,0 +1,207 @@
+#include "flow/Blocks.h"
+#include "AudioResampler.h"
+#include "AudioBroadcast.h"
+#include "ChannelFilter.h"
+#include "FMDemodulator.h"
+#include "Logging.h"
+#include "MpxFile.h"
+#include "RDSDecoder.h"
+#include "SpectrumMonitor.h"
+#include "Squelch.h"
+#include "StereoDecoder.h"
+#include <algorithm>
+
+ChannelFilterBlock::ChannelFilterBlock(ChannelFilter& chan, Squelch* sq, double block_s)
+  : FlowBlock("channel"), chan_(chan), sq_(sq), block_s_(block_s) {
+  sq_open_ = (sq_ == nullptr);
+}
+
+bool ChannelFilterBlock::work() {
+  auto c = in.pop();
+  if (!c) return false;
+
+  if (c->tag.epoch != in_epoch_) {
+    in_epoch_ = c->tag.epoch;
+    chan_.set_offset(c->tag.offset_hz);
+    // the squelch keeps its state through a retune and re-measures from here
+    if (sq_) sq_->remeasure();
+    out_epoch_++;
+  }
+  chan_.set_low_cost(c->tag.tier >= 2);
+
+  auto o = out.acquire();
+  size_t cap = c->n / chan_.decim() + 8;
+  if (o->data.size() < cap) o->data.resize(cap);
+  o->n = chan_.process(c->data.cview(c->n), o->data.view(0, cap));
+  o->tag = c->tag;
+
+  if (sq_) {
+    if (sq_->update(o->data.cview(o->n), block_s_)) {
+      sq_open_ = sq_->is_open();
+      // the chain has been idle or sees a different signal; restart it clean
+      if (sq_->is_open()) out_epoch_++;
+      log_msg(LogLevel::Info, "Squelch %s (%.1f dBFS, flatness %.2f)",
+              sq_->is_open() ? "open" : "closed", sq_->power_db(), sq_->flatness());
+    }
+    power_db_ = sq_->power_db();
+    if (!sq_->is_open()) {
+      o->tag.gated = true;
+      gated_++;
+    }
+  }
+  o->tag.epoch = out_epoch_;
+  o->tag.sample = out_samples_;
+  out_samples_ += o->n;
+  return out.push(o);
+}
+
+FMDemodBlock::FMDemodBlock(FMDemodulator& demod) : FlowBlock("demod"), demod_(demod) {}
+
+bool FMDemodBlock::work() {
+  auto c = in.pop();
+  if (!c) return false;
+
+  if (c->tag.epoch != epoch_) {
+    epoch_ = c->tag.epoch;
+    demod_.reset();
+  }
+  demod_.set_fast(c->tag.tier >= 3);
+
+  auto o = out.acquire();
+  o->tag = c->tag;
+  if (c->tag.gated) {
+    o->n = c->n;   // sample count only, for silence downstream
+  } else {
+    if (o->data.size() < c->n) o->data.resize(c->n);
+    o->n = demod_.process(c->data.cview(c->n), o->data.data(), o->data.size());
+  }
+  return out.push(o);
+}
+
+RDSBlock::RDSBlock(RDSDecoder& rds) : FlowBlock("rds"), rds_(rds) {}
+
+bool RDSBlock::work() {
+  auto c = in.pop();
+  if (!c) return false;
+
+  // Dropping RDS loses its sync, so start clean when it comes back.
+  bool on = c->tag.rds && c->tag.tier < 1;
+  bool restart = (c->tag.epoch != epoch_) || (on && !on_);
+  epoch_ = c->tag.epoch;
+  on_ = on;
+  if (restart) rds_.reset();
+
+  tag_ = c->tag;
+  if (on_ && !c->tag.gated) rds_.process(c->data.data(), c->n);
+  ctl_seen_ = c->tag.ctl;
+  return true;
+}
+
+AudioBlock::AudioBlock(AudioResampler& mono, StereoDecoder* stereo, double fs_mpx, double fs_audio,
+                       bool emit_silence)
+  : FlowBlock("audio"), mono_(mono), stereo_(stereo), ratio_(fs_audio / fs_mpx),
+    emit_silence_(emit_silence) {}
+
+bool AudioBlock::work() {
+  auto c = in.pop();
+  if (!c) return false;
+  const ChunkTag& tag = c->tag;
+
+  if (tag.epoch != epoch_) {
+    epoch_ = tag.epoch;
+    mono_.reset();
+    if (stereo_) stereo_->reset();
+  } else if (stereo_ && tag.tier != tier_) {
+    // Stereo hands over to the mono path at tier 2; restart whichever resumes.
+    if (tier_ >= 2 && tag.tier < 2) stereo_->reset();
+    if (tier_ < 2 && tag.tier >= 2) mono_.reset();
+  }
+  tier_ = tag.tier;
+  mono_.set_low_cost(tier_ >= 2);
+  if (tag.audio_gain != gain_) {
+    gain_ = tag.audio_gain;
+    mono_.set_audio_gain(gain_);
+    if (stereo_) stereo_->set_audio_gain(gain_);
+  }
+
+  const size_t ch = stereo_ ? 2 : 1;
+  size_t cap = size_t(double(c->n) * ratio_) + 8;
+  auto o = out.acquire();
+  if (o->data.size() < cap * 2) o->data.resize(cap * 2);
+  int16_t* pcm = o->data.data();
+  o->tag = tag;
+
+  if (tag.gated) {
+    // keep the audio clock running for sinks that expect a continuous stream
+    size_t frames = 0;
+    if (emit_silence_) {
+      frac_ += double(c->n) * ratio_;
+      frames = std::min(size_t(frac_), cap);
+      frac_ -= double(frames);
+      std::fill(pcm, pcm + frames * ch, int16_t(0));
+    }
+    o->n = frames * ch;
+  } else if (stereo_ && tier_ < 2) {
+    o->n = 2 * stereo_->process(c->data.data(), c->n, pcm, cap);
+  } else if (stereo_) {
+    // overloaded: mono path, duplicated to keep the stream format
+    size_t n = mono_.process(c->data.data(), c->n, pcm, cap);
+    for (size_t i = n; i-- > 0;) pcm[2*i] = pcm[2*i + 1] = pcm[i];
+    o->n = 2 * n;
+  } else {
+    o->n = mono_.process(c->data.data(), c->n, pcm, cap);
+  }
+  // pushed even when empty: the sink reports the tag's control sequence
+  return out.push(o);
+}
+
+AudioRingSinkBlock::AudioRingSinkBlock(AudioBroadcast& rb) : FlowBlock("audio-out"), rb_(rb) {}
+
+bool AudioRingSinkBlock::work() {
+  auto c = in.pop();
+  if (!c) return false;
+  if (c->n) rb_.push(c->data.data(), c->n, c->tag.t_ns);
+  ctl_seen_ = c->tag.ctl;
+  return true;
+}
+
+MpxTapBlock::MpxTapBlock(MpxWriter& w) : FlowBlock("mpx-tap"), w_(w) {}
+
+bool MpxTapBlock::work() {
+  auto c = in.pop();
+  if (!c) return false;
+  const ChunkTag& t = c->tag;
+  if (t.sample > next_) {
+    // the lossy connection dropped chunks before this one
+    w_.write(nullptr, size_t(t.sample - next_), t.t_ns, t.epoch, true);
+    gap_samples_ += t.sample - next_;
+  }
+  // gated chunks hold no samples, only their count
+  w_.write(t.gated ? nullptr : c->data.data(), c->n, t.t_ns, t.epoch, t.gated);
+  next_ = t.sample + c->n;
+  last_ = t;
+  return true;
+}
+
+void MpxTapBlock::pad_to(uint64_t end) {
+  if (end <= next_) return;
+  w_.write(nullptr, size_t(end - next_), last_.t_ns, last_.epoch, true);
+  gap_samples_ += end - next_;
+  next_ = end;
+}
+
+SpectrumTapBlock::SpectrumTapBlock(const char* name, SpectrumMonitor& mon,
+                                   std::function<double(const ChunkTag&)> center)
+  : FlowBlock(name), mon_(mon), center_(std::move(center)) {}
+
+bool SpectrumTapBlock::work() {
+  auto c = in.pop();
+  if (!c) return false;
+  if (c->tag.epoch != epoch_) {
+    epoch_ = c->tag.epoch;
+    mon_.reset();
+  }
+  // a squelched channel carries no samples
+  if (!c->tag.gated) mon_.process(c->data.cview(c->n), c->tag.t_ns, center_(c->tag));
+  return true;
+}
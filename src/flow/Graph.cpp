@@ -0,0 +1,105 @@
+#include "flow/Graph.h"
+#include "LatencyStats.h"
+#include "Logging.h"
+
+uint64_t flow_now_ns() { return mono_ns(); }
+
+OutPortBase::OutPortBase(FlowBlock* owner) : owner_(owner) {
+  owner_->outs_.push_back(this);
+}
+
+bool FlowBlock::step() {
+  uint64_t t0 = flow_now_ns();
+  wait_ns_ = 0;
+  bool more = work();
+  uint64_t el = flow_now_ns() - t0;
+  busy_ns_ += (el > wait_ns_) ? el - wait_ns_ : 0;
+  return more;
+}
+
+bool FlowBlock::ready() const {
+  if (ins_.empty()) return false;
+  for (auto* q : ins_) {
+    if (!q->ready()) return false;
+  }
+  return true;
+}
+
+void FlowBlock::close_outputs() {
+  // end of stream propagates downstream once readers drain what is queued
+  for (auto* o : outs_) o->close();
+}
+
+void FlowBlock::run() {
+  if (!policy_.empty()) apply_thread_policy("flow:" + name_, policy_);
+  while (step()) {}
+  close_outputs();
+}
+
+FlowGraph::~FlowGraph() { stop(); }
+
+void FlowGraph::start(bool threaded) {
+  if (!threads_.empty()) return;
+  threaded_ = threaded;
+  if (threaded_) {
+    for (auto& b : blocks_) threads_.emplace_back(&FlowBlock::run, b.get());
+  } else {
+    threads_.emplace_back(&FlowGraph::run_serial, this);
+  }
+  log_msg(LogLevel::Info, "FlowGraph: %zu blocks, %zu connections, %s", blocks_.size(), queues_.size(),
+          threaded_ ? "one thread per block" : "one thread");
+}
+
+void FlowGraph::run_serial() {
+  if (!blocks_.empty() && !blocks_[0]->policy_.empty()) apply_thread_policy("flow", blocks_[0]->policy_);
+  std::vector<bool> done(blocks_.size(), false);
+  size_t live = blocks_.size();
+  while (live > 0) {
+    // Drain downstream before the sources produce again: queues never
+    // hold more than one chunk, so no push waits on a reader.
+    bool progress = false;
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+      FlowBlock* b = blocks_[i].get();
+      if (done[i] || !b->ready()) continue;
+      progress = true;
+      if (!b->step()) {
+        done[i] = true;
+        live--;
+        b->close_outputs();
+      }
+    }
+    if (progress) continue;
+    bool sources = false;
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+      FlowBlock* b = blocks_[i].get();
+      if (done[i] || !b->ins_.empty()) continue;
+      sources = true;
+      if (!b->step()) {
+        done[i] = true;
+        live--;
+        b->close_outputs();
+      }
+    }
+    if (!sources) break;   // blocks without a source feeding them
+  }
+}
+
+void FlowGraph::wait() {
+  for (auto& t : threads_) {
+    if (t.joinable()) t.join();
+  }
+  threads_.clear();
+}
+
+void FlowGraph::stop() {
+  for (auto& q : queues_) q->close();
+  wait();
+}
+
+uint64_t FlowGraph::max_busy_ns() const {
+  uint64_t m = 0;
+  for (auto& b : blocks_) {
+    if (!b->monitor()) m = std::max(m, b->busy_ns());
+  }
+  return m;
+}
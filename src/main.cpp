@@ -1,21 +1,211 @@
 #include "Config.h"
 #include "Logging.h"
 #include "FMReceiver.h"
-#include "AudioRingBuffer.h"
+#include "AudioBroadcast.h"
 #include "WavWriter.h"
+#include "RtpSink.h"
+#include "BandScanner.h"
+#include "RealTime.h"
+#include "ReceiverSet.h"
+#include "HackRFDevice.h"
+#include "MpxFile.h"
+#include "AudioResampler.h"
+#include "StereoDecoder.h"
+#include "RDSDecoder.h"
+#include "RdsArchive.h"
+#include "ControlServer.h"
+#include <algorithm>
 #include <chrono>
 #include <thread>
+#include <cstdio>
 #include <cstring>
 
 static void print_usage() {
   std::fprintf(stderr,
-    "Usage: fm_relay --freq <MHz> [--sr <Hz>] [--lna <dB>] [--vga <dB>] [--wav <path>] [--seconds <N>]\n"
-    "Defaults: freq=99.9, sr=9600000, lna=16, vga=20, wav=out.wav, seconds=20\n");
+    "Usage: fm_relay [options]                                         receive one station\n"
+    "       fm_relay --rx <device>@<MHz> [--rx ...] [options]          one pipeline per device\n"
+    "       fm_relay --scan [--scan-rds [--scan-dwell <s>]] [options]  find stations\n"
+    "       fm_relay --mpx-in <path> [--mpx-seek <s>] [options]        replay an MPX capture\n"
+    "       fm_relay --list-devices\n"
+    "\n"
+    "Tuning and device:\n"
+    "  --freq <MHz>  --sr <Hz>  --lna <dB>  --vga <dB>\n"
+    "  --device <serial|file:path|synth[:MHz]>\n"
+    "  --offset-tune [--offset <Hz>]\n"
+    "Audio and outputs:\n"
+    "  --wav <path>  --seconds <N>  --stereo\n"
+    "  --rtp <host:port>...  --rtp-ptime <ms>  --rtp-ttl <N>  --rtp-paced [--rtp-fill <ms>]\n"
+    "  --mpx-out <path> [--mpx-f16]\n"
+    "  --squelch <dBFS> [--squelch-drop]\n"
+    "RDS:\n"
+    "  --no-rds  --rds-auto  --rds-archive <dir>\n"
+    "Monitoring and control:\n"
+    "  --spectrum-iq <path|udp:ip:port>  --spectrum-ch <path|udp:ip:port>\n"
+    "  --spectrum-fft <N>  --spectrum-rate <fps>  --spectrum-avg <N>  --spectrum-budget <percent>\n"
+    "  --control <socket path>  (single receiver only)\n"
+    "Performance:\n"
+    "  --low-latency  --block <IQ bytes>  --no-governor\n"
+    "  --graph-threads  (one thread per pipeline stage)\n"
+    "  --cpu-dsp <list>  --cpu-usb <n>  --cpu-sink <n>  --rt-prio <1..99>\n"
+    "  --mlock  --prefault  --hugepages thp|explicit\n"
+    "\n"
+    "--mpx-in uses --stereo, --no-rds, --rds-auto, --wav, --rds-archive and --squelch-drop.\n"
+    "Defaults: freq=99.9, sr=9600000, lna=16, vga=20, wav=out.wav, seconds=20, rtp-ptime=5\n");
+}
+
+static void log_rds_auto(const char* who, const RdsAutoStats& s) {
+  log_msg(LogLevel::Info, "%sRDS auto: decoder %s, %llu on / %llu off, %.1f s skipped, %.2f s CPU saved, "
+          "last probe %.1f dB over floor",
+          who, s.engaged ? "on" : "off", (unsigned long long)s.engages, (unsigned long long)s.disengages,
+          s.idle_s, s.saved_cpu_s, s.snr_db);
+}
+
+// Several receivers, one pipeline per device, each writing its own WAV.
+static int run_multi(const ReceiverConfig& cfg, const std::vector<std::pair<std::string, double>>& rx_list,
+                     int seconds) {
+  if (!cfg.rtp_dests.empty()) {
+    log_msg(LogLevel::Error, "RTP relay needs a single receiver");
+    return 1;
+  }
+  if (!cfg.control_socket.empty()) {
+    log_msg(LogLevel::Error, "Control socket needs a single receiver");
+    return 1;
+  }
+  ReceiverSet set(cfg);
+  for (const auto& r : rx_list) {
+    if (!set.add(r.first, r.second)) return 1;
+  }
+  if (!set.start()) {
+    log_msg(LogLevel::Error, "Receiver start failed");
+    return 1;
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  int last_report = 0;
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto now = std::chrono::steady_clock::now();
+    int elapsed = int(std::chrono::duration_cast<std::chrono::seconds>(now - t0).count());
+    if (elapsed >= seconds) break;
+    if ((elapsed % 5) != 0 || elapsed == last_report) continue;
+    last_report = elapsed;
+
+    for (size_t i = 0; i < set.size(); ++i) {
+      const FMReceiver& rx = set.receiver(i);
+      auto ps = rx.program_service();
+      log_msg(LogLevel::Info, "RX %zu %s: %.3f MHz, PS=%s, tier %d%s", i, rx.source_label().c_str(),
+              rx.config().rf_freq_hz / 1e6, ps.empty() ? "-" : ps.c_str(), rx.quality_tier(),
+              rx.squelch_open() ? "" : ", squelched");
+      if (cfg.rds_auto) {
+        char who[32];   // "RX " and any size_t
+        std::snprintf(who, sizeof(who), "RX %zu ", i);
+        log_rds_auto(who, rx.rds_auto_stats());
+      }
+    }
+    ReceiverSetStats st = set.stats();
+    log_msg(LogLevel::Info, "All %zu: worst RTF %.2f, worst tier %d, IQ overruns %llu, squelched blocks %llu",
+            st.receivers, st.worst_rtf, st.worst_tier, (unsigned long long)st.iq_overruns,
+            (unsigned long long)st.squelched_blocks);
+  }
+
+  set.stop();
+  ReceiverSetStats st = set.stats();
+  log_msg(LogLevel::Info, "Done. %zu receivers, %.1f s of audio in total",
+          st.receivers, double(st.audio_samples) / (cfg.audio_rate_hz * (cfg.stereo ? 2 : 1)));
+  return 0;
+}
+
+// Reruns RDS and audio on a recorded MPX capture, as fast as they go.
+static int run_mpx_replay(const ReceiverConfig& cfg, const std::string& path, double seek_s) {
+  MpxReader in;
+  if (!in.open(path)) return 1;
+  const MpxInfo& info = in.info();
+  log_msg(LogLevel::Info, "MPX replay: %s, %.3f MHz, %.0f Hz, %.1f s in %zu chunks", path.c_str(),
+          info.rf_freq_hz / 1e6, info.fs_hz, double(info.total_samples) / info.fs_hz, in.chunks());
+  if (seek_s > 0.0 && !in.seek(uint64_t(seek_s * info.fs_hz))) {
+    log_msg(LogLevel::Error, "MPX seek to %.1f s failed", seek_s);
+    return 1;
+  }
+
+  AudioResampler mono(info.fs_hz, cfg.audio_rate_hz, cfg.deemph_tau_s, cfg.audio_cut_hz);
+  std::unique_ptr<StereoDecoder> stereo;
+  if (cfg.stereo) stereo.reset(new StereoDecoder(info.fs_hz, cfg.audio_rate_hz, cfg.deemph_tau_s, cfg.audio_cut_hz));
+  RDSDecoder rds(info.fs_hz);
+  rds.set_enabled(cfg.enable_rds);
+  rds.set_auto(cfg.rds_auto);
+
+  // Archived groups are stamped from the capture's start time and sample position.
+  RdsArchiveWriter archive;
+  uint64_t t_us = 0;
+  if (!cfg.rds_archive_dir.empty()) {
+    if (!archive.open(cfg.rds_archive_dir)) return 1;
+    rds.set_group_callback([&](const RdsGroup& g) { archive.append(g, t_us, info.rf_freq_hz); });
+  }
+
+  const uint16_t channels = cfg.stereo ? 2 : 1;
+  WavWriter wav;
+  if (cfg.write_wav && !wav.open(cfg.wav_path, uint32_t(cfg.audio_rate_hz), channels)) {
+    log_msg(LogLevel::Error, "WAV open failed");
+    return 1;
+  }
+
+  std::vector<float> mpx(8192);
+  std::vector<int16_t> pcm(2 * (size_t(double(mpx.size()) * cfg.audio_rate_hz / info.fs_hz) + 8));
+  const size_t cap = pcm.size() / 2;
+  uint64_t samples = 0;
+  uint32_t epoch = 0;
+  bool first = true, gated = false;
+  double frac = 0.0;
+  auto t0 = std::chrono::steady_clock::now();
+  MpxChunkInfo ci;
+  while (size_t n = in.read(mpx.data(), mpx.size(), &ci)) {
+    // the receiver restarted its chain here; do the same. Signal after a
+    // gated span (squelch, or chunks the capture dropped) starts clean too.
+    if (first || ci.epoch != epoch || (gated && !ci.gated)) {
+      mono.reset();
+      if (stereo) stereo->reset();
+      rds.reset();
+      epoch = ci.epoch;
+      first = false;
+    }
+    gated = ci.gated;
+    t_us = info.start_unix_ns / 1000 + uint64_t(double(ci.first_sample + n) * 1e6 / info.fs_hz);
+    size_t frames = 0;
+    if (gated) {
+      // no signal recorded: silence at the audio rate, as the receiver
+      // wrote it, or nothing with --squelch-drop
+      if (cfg.squelch_silence) {
+        frac += double(n) * cfg.audio_rate_hz / info.fs_hz;
+        frames = std::min(size_t(frac), cap);
+        frac -= double(frames);
+        std::fill(pcm.data(), pcm.data() + frames * channels, int16_t(0));
+      }
+    } else {
+      rds.process(mpx.data(), n);
+      frames = stereo ? stereo->process(mpx.data(), n, pcm.data(), cap)
+                      : mono.process(mpx.data(), n, pcm.data(), cap);
+    }
+    if (cfg.write_wav && frames) wav.write_i16(pcm.data(), frames);
+    samples += n;
+  }
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  double audio_s = double(samples) / info.fs_hz;
+  auto ps = rds.program_service();
+  log_msg(LogLevel::Info, "MPX replay: %.1f s of audio in %.2f s (%.0fx real time), PI %04X, PS=%s",
+          audio_s, wall, wall > 0.0 ? audio_s / wall : 0.0, rds.program_id(), ps.empty() ? "-" : ps.c_str());
+  if (archive.is_open()) log_msg(LogLevel::Info, "RDS archive: %llu groups", (unsigned long long)archive.records());
+  if (cfg.rds_auto) log_rds_auto("", rds.auto_stats());
+  wav.close();
+  return 0;
 }
 
 int main(int argc, char** argv) {
   ReceiverConfig cfg;
   int seconds = 20;
+  bool scan = false;
+  std::vector<std::pair<std::string, double>> rx_list;   // --rx device@MHz
+  std::string mpx_in;
+  double mpx_seek_s = 0.0;
 
   for (int i = 1; i < argc; ++i) {
     if (!std::strcmp(argv[i], "--freq") && i + 1 < argc) cfg.rf_freq_hz = std::atof(argv[++i]) * 1e6;
@@ -25,16 +215,152 @@ int main(int argc, char** argv) {
     else if (!std::strcmp(argv[i], "--wav") && i + 1 < argc) cfg.wav_path = argv[++i];
     else if (!std::strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = std::atoi(argv[++i]);
     else if (!std::strcmp(argv[i], "--no-rds")) cfg.enable_rds = false;
+    else if (!std::strcmp(argv[i], "--rds-auto")) cfg.rds_auto = true;
+    else if (!std::strcmp(argv[i], "--stereo")) cfg.stereo = true;
+    else if (!std::strcmp(argv[i], "--squelch") && i + 1 < argc) { cfg.squelch = true; cfg.squelch_db = float(std::atof(argv[++i])); }
+    else if (!std::strcmp(argv[i], "--squelch-drop")) cfg.squelch_silence = false;
+    else if (!std::strcmp(argv[i], "--scan")) scan = true;
+    else if (!std::strcmp(argv[i], "--scan-rds")) cfg.scan_rds = true;
+    else if (!std::strcmp(argv[i], "--scan-dwell") && i + 1 < argc) cfg.scan_dwell_s = std::atof(argv[++i]);
+    else if (!std::strcmp(argv[i], "--offset-tune")) cfg.offset_tune = true;
+    else if (!std::strcmp(argv[i], "--offset") && i + 1 < argc) cfg.tune_offset_hz = std::atof(argv[++i]);
+    else if (!std::strcmp(argv[i], "--no-governor")) cfg.auto_degrade = false;
+    else if (!std::strcmp(argv[i], "--graph-threads")) cfg.graph_threads = true;
+    else if (!std::strcmp(argv[i], "--low-latency")) cfg.block_bytes = 16384;
+    else if (!std::strcmp(argv[i], "--block") && i + 1 < argc) cfg.block_bytes = uint32_t(std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--rtp") && i + 1 < argc) cfg.rtp_dests.push_back(argv[++i]);
+    else if (!std::strcmp(argv[i], "--rtp-ptime") && i + 1 < argc) cfg.rtp_packet_ms = std::atof(argv[++i]);
+    else if (!std::strcmp(argv[i], "--rtp-ttl") && i + 1 < argc) cfg.rtp_ttl = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--rtp-paced")) cfg.rtp_paced = true;
+    else if (!std::strcmp(argv[i], "--rtp-fill") && i + 1 < argc) cfg.rtp_fill_ms = std::atof(argv[++i]);
+    else if (!std::strcmp(argv[i], "--control") && i + 1 < argc) cfg.control_socket = argv[++i];
+    else if ((!std::strcmp(argv[i], "--cpu-dsp") || !std::strcmp(argv[i], "--cpu-usb") ||
+              !std::strcmp(argv[i], "--cpu-sink") || !std::strcmp(argv[i], "--rt-prio")) && i + 1 < argc) {
+      const char* opt = argv[i];
+      const char* v = argv[++i];
+      char* end = nullptr;
+      bool ok;
+      if (!std::strcmp(opt, "--cpu-dsp")) ok = parse_cpu_list(v, cfg.cpu_dsp);
+      else if (!std::strcmp(opt, "--cpu-usb")) ok = parse_cpu(v, cfg.cpu_usb);
+      else if (!std::strcmp(opt, "--cpu-sink")) ok = parse_cpu(v, cfg.cpu_sink);
+      else {
+        long p = std::strtol(v, &end, 10);
+        ok = end != v && *end == '\0' && p >= 1 && p <= 99;
+        cfg.rt_prio = int(p);
+      }
+      if (!ok) {
+        log_msg(LogLevel::Error, "%s: bad value '%s' (%s)", opt, v,
+                !std::strcmp(opt, "--rt-prio") ? "1..99" : "CPU numbers, e.g. 2 or 2,3");
+        print_usage();
+        return 1;
+      }
+    }
+    else if (!std::strcmp(argv[i], "--mlock")) cfg.mlock = true;
+    else if (!std::strcmp(argv[i], "--prefault")) cfg.prefault = true;
+    else if (!std::strcmp(argv[i], "--hugepages") && i + 1 < argc) {
+      const char* m = argv[++i];
+      if (!std::strcmp(m, "thp")) cfg.huge_pages = HugePages::Transparent;
+      else if (!std::strcmp(m, "explicit")) cfg.huge_pages = HugePages::Explicit;
+      else { print_usage(); return 1; }
+    }
+    else if (!std::strcmp(argv[i], "--device") && i + 1 < argc) cfg.device = argv[++i];
+    else if (!std::strcmp(argv[i], "--mpx-out") && i + 1 < argc) cfg.mpx_path = argv[++i];
+    else if (!std::strcmp(argv[i], "--mpx-f16")) cfg.mpx_f16 = true;
+    else if (!std::strcmp(argv[i], "--spectrum-iq") && i + 1 < argc) cfg.spectrum_iq = argv[++i];
+    else if (!std::strcmp(argv[i], "--spectrum-ch") && i + 1 < argc) cfg.spectrum_ch = argv[++i];
+    else if (!std::strcmp(argv[i], "--spectrum-fft") && i + 1 < argc) cfg.spectrum_fft = size_t(std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--spectrum-rate") && i + 1 < argc) cfg.spectrum_rate_hz = std::atof(argv[++i]);
+    else if (!std::strcmp(argv[i], "--spectrum-avg") && i + 1 < argc) cfg.spectrum_avg = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--spectrum-budget") && i + 1 < argc) cfg.spectrum_budget = std::atof(argv[++i]) / 100.0;
+    else if (!std::strcmp(argv[i], "--rds-archive") && i + 1 < argc) cfg.rds_archive_dir = argv[++i];
+    else if (!std::strcmp(argv[i], "--mpx-in") && i + 1 < argc) mpx_in = argv[++i];
+    else if (!std::strcmp(argv[i], "--mpx-seek") && i + 1 < argc) mpx_seek_s = std::atof(argv[++i]);
+    else if (!std::strcmp(argv[i], "--rx") && i + 1 < argc) {
+      std::string a = argv[++i];
+      size_t at = a.rfind('@');
+      if (at == std::string::npos) { print_usage(); return 1; }
+      rx_list.emplace_back(a.substr(0, at), std::atof(a.c_str() + at + 1) * 1e6);
+    }
+    else if (!std::strcmp(argv[i], "--list-devices")) {
+      for (const auto& sn : HackRFDevice::list_serials()) std::printf("%s\n", sn.c_str());
+      return 0;
+    }
     else { print_usage(); return 1; }
   }
 
+  if (!mpx_in.empty()) return run_mpx_replay(cfg, mpx_in, mpx_seek_s);
+
+  if (scan) {
+    BandScanner scanner(cfg);
+    std::vector<ScanResult> found;
+    if (!scanner.run(found)) {
+      log_msg(LogLevel::Error, "Scan failed");
+      return 1;
+    }
+    for (const auto& r : found) {
+      if (r.pi) {
+        log_msg(LogLevel::Info, "%7.1f MHz  %6.1f dBFS  SNR %5.1f dB  PI %04X  PS %s",
+                r.freq_hz / 1e6, r.power_db, r.snr_db, r.pi, r.ps.c_str());
+      } else {
+        log_msg(LogLevel::Info, "%7.1f MHz  %6.1f dBFS  SNR %5.1f dB",
+                r.freq_hz / 1e6, r.power_db, r.snr_db);
+      }
+    }
+    return 0;
+  }
+
+  if (rx_list.size() == 1) {
+    cfg.device = rx_list[0].first;
+    cfg.rf_freq_hz = rx_list[0].second;
+    rx_list.clear();
+  }
+  for (const auto& r : rx_list) {
+    if (r.second < 87.5e6 || r.second > 108.0e6) {
+      log_msg(LogLevel::Error, "Frequency out of FM band: %s", r.first.c_str());
+      return 1;
+    }
+  }
   if (cfg.rf_freq_hz < 87.5e6 || cfg.rf_freq_hz > 108.0e6) {
     log_msg(LogLevel::Error, "Frequency out of FM band");
     return 1;
   }
 
-  AudioRingBuffer audio_rb(48000 * 10);
-  FMReceiver rx(cfg, audio_rb);
+  // HackRF One supports 2..20 MS/s; the audio stage resamples any of them to the audio rate
+  if (cfg.sample_rate_hz < 2e6 || cfg.sample_rate_hz > 20e6) {
+    log_msg(LogLevel::Error, "Sample rate must be 2..20 MS/s");
+    return 1;
+  }
+
+  const size_t nfft = cfg.spectrum_fft;
+  if (nfft < 64 || nfft > 16384 || (nfft & (nfft - 1)) != 0 || cfg.spectrum_rate_hz <= 0.0 ||
+      cfg.spectrum_avg < 1 || cfg.spectrum_budget <= 0.0) {
+    log_msg(LogLevel::Error, "Spectrum: FFT size must be a power of two in 64..16384, rate, averaging and budget > 0");
+    return 1;
+  }
+
+  // before any pipeline allocation, so everything after is locked as it is touched
+  if (cfg.mlock) lock_memory();
+
+  // The sinks run one step below the DSP threads: they only drain buffers.
+  ThreadPolicy sink_policy;
+  sink_policy.cpu = cfg.cpu_sink;
+  sink_policy.fifo_prio = cfg.rt_prio > 1 ? cfg.rt_prio - 1 : 0;
+  if (!sink_policy.empty()) apply_thread_policy("main", sink_policy);
+
+  if (!rx_list.empty()) return run_multi(cfg, rx_list, seconds);
+
+  const uint16_t channels = cfg.stereo ? 2 : 1;
+  const uint32_t rate = uint32_t(cfg.audio_rate_hz);
+  // One writer (the receiver), one reader per sink; each sink reads the
+  // shared PCM at its own pace.
+  AudioBroadcast audio(size_t(rate) * 10 * channels, channels, cfg.huge_pages);
+  if (!audio.init()) return 1;
+  AudioReader* wav_in = cfg.write_wav ? &audio.add_reader("wav") : nullptr;
+  bool use_rtp = !cfg.rtp_dests.empty();
+  // RTP is live: it keeps at most a second of backlog, as its own ring used to
+  std::unique_ptr<RtpSink> rtp;
+  if (use_rtp) rtp.reset(new RtpSink(audio.add_reader("rtp", size_t(rate) * channels), rate, channels));
+  FMReceiver rx(cfg, audio);
 
   if (!rx.start()) {
     log_msg(LogLevel::Error, "Receiver start failed");
@@ -43,34 +369,119 @@ int main(int argc, char** argv) {
 
   WavWriter wav;
   if (cfg.write_wav) {
-    if (!wav.open(cfg.wav_path, 48000, 1)) {
+    if (!wav.open(cfg.wav_path, rate, channels)) {
       log_msg(LogLevel::Error, "WAV open failed");
       rx.stop();
       return 1;
     }
   }
 
+  // The RTP sink runs on its own thread
+  if (use_rtp) {
+    if (cfg.rtp_paced) rtp->set_paced(cfg.rtp_fill_ms);
+    rtp->set_thread_policy(sink_policy);
+    if (!rtp->open(cfg.rtp_dests, cfg.rtp_packet_ms, 96, cfg.rtp_ttl) || !rtp->start()) {
+      log_msg(LogLevel::Error, "RTP sink start failed");
+      rx.stop();
+      return 1;
+    }
+  }
+
+  // Live retune and gain changes while streaming
+  ControlServer control(rx);
+  if (!cfg.control_socket.empty() && !control.start(cfg.control_socket)) {
+    rx.stop();
+    return 1;
+  }
+
   auto t0 = std::chrono::steady_clock::now();
-  std::vector<int16_t> out(48000 / 2);
+  LatencyStats wav_latency;
+  int last_report = -1;
+  std::vector<int16_t> pcm(rate / 2);
 
   while (true) {
     auto now = std::chrono::steady_clock::now();
     int elapsed = int(std::chrono::duration_cast<std::chrono::seconds>(now - t0).count());
     if (elapsed >= seconds) break;
 
-    size_t n = audio_rb.pop(out.data(), out.size());
-    if (n > 0 && cfg.write_wav) wav.write_i16(out.data(), n);
+    if (wav_in) {
+      uint64_t t_ns = 0;
+      // Timed so the loop still ends on schedule when a closed squelch
+      // emits nothing.
+      size_t n = wav_in->pop_for(pcm.data(), pcm.size(), t_ns, 200);
+      if (n > 0) {
+        wav.write_i16(pcm.data(), n / channels);
+        wav_latency.record(t_ns, mono_ns());
+      }
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
 
-    if ((elapsed % 5) == 0) {
+    if ((elapsed % 5) == 0 && elapsed != last_report) {
+      last_report = elapsed;
       auto ps = rx.program_service();
-      if (!ps.empty()) log_msg(LogLevel::Info, "Status: %.3f MHz, PS=%s", cfg.rf_freq_hz / 1e6, ps.c_str());
+      if (!ps.empty()) log_msg(LogLevel::Info, "Status: %.3f MHz, PS=%s", rx.settings().rf_freq_hz / 1e6, ps.c_str());
+      if (cfg.stereo) {
+        log_msg(LogLevel::Info, "Stereo: %s, pilot %.2f", rx.stereo_locked() ? "locked" : "mono", rx.pilot_level());
+      }
+      if (cfg.squelch) {
+        log_msg(LogLevel::Info, "Squelch: %s, channel %.1f dBFS, %llu blocks skipped",
+                rx.squelch_open() ? "open" : "closed", rx.channel_power_db(),
+                (unsigned long long)rx.squelched_blocks());
+      }
+      if (rx.quality_tier() > 0 || rx.iq_overruns() > 0) {
+        log_msg(LogLevel::Info, "Load: RTF %.2f, quality tier %d (%s), IQ overruns %llu",
+                rx.rtf(), rx.quality_tier(), OverloadGovernor::tier_name(rx.quality_tier()),
+                (unsigned long long)rx.iq_overruns());
+      }
+      if (cfg.write_wav && wav_latency.count() > 0) {
+        log_msg(LogLevel::Info, "Latency (USB->wav): p50=%.2f ms p99=%.2f ms",
+                wav_latency.percentile_ms(0.5), wav_latency.percentile_ms(0.99));
+      }
+      if (use_rtp && rtp->latency().count() > 0) {
+        log_msg(LogLevel::Info, "Latency (USB->rtp): p50=%.2f ms p99=%.2f ms",
+                rtp->latency().percentile_ms(0.5), rtp->latency().percentile_ms(0.99));
+      }
+      if (use_rtp && cfg.rtp_paced) {
+        log_msg(LogLevel::Info, "RTP drift: %+.1f ppm, fill %.1f ms", rtp->drift_ppm(), rtp->fill_ms());
+      }
+      for (const auto& r : audio.readers()) {
+        if (r->dropped() > 0) {
+          log_msg(LogLevel::Info, "Audio sink %s: %llu samples dropped (fell behind)", r->name().c_str(),
+                  (unsigned long long)r->dropped());
+        }
+      }
+      for (const SpectrumMonitor* m : {rx.spectrum_iq(), rx.spectrum_ch()}) {
+        if (!m) continue;
+        log_msg(LogLevel::Info, "Spectrum %s: %llu frames, %d FFTs per frame",
+                m->source() == SpectrumSource::Wideband ? "wideband" : "channel",
+                (unsigned long long)m->frames(), m->ffts_per_frame());
+      }
+      if (cfg.rds_auto) log_rds_auto("", rx.rds_auto_stats());
+      if (cfg.mlock || cfg.prefault) {
+        log_msg(LogLevel::Info, "Page faults while streaming: %ld", rx.page_faults_streaming());
+      }
     }
   }
 
+  control.stop();
   rx.stop();
-  audio_rb.stop();
+  audio.stop();
+  if (rtp) rtp->close();
   wav.close();
 
+  if (cfg.write_wav && wav_latency.count() > 0) {
+    log_msg(LogLevel::Info, "Latency (USB->wav): p50=%.2f ms p99=%.2f ms over %llu blocks",
+            wav_latency.percentile_ms(0.5), wav_latency.percentile_ms(0.99),
+            (unsigned long long)wav_latency.count());
+  }
+  if (use_rtp) {
+    log_msg(LogLevel::Info, "Latency (USB->rtp): p50=%.2f ms p99=%.2f ms",
+            rtp->latency().percentile_ms(0.5), rtp->latency().percentile_ms(0.99));
+    log_msg(LogLevel::Info, "RTP: %llu packets sent, %llu send errors",
+            (unsigned long long)rtp->packets_sent(), (unsigned long long)rtp->send_errors());
+  }
+  if (cfg.rds_auto) log_rds_auto("", rx.rds_auto_stats());
   log_msg(LogLevel::Info, "Done. Wrote %s", cfg.wav_path.c_str());
   return 0;
 }
@@ -0,0 +1,148 @@
+// Time-range queries over an RDS group archive written by fm_relay --rds-archive.
+//
+//   rds_query <dir>                               list stations
+//   rds_query <dir> <PI> <from> <to> [--text]     groups of one station
+//
+// Times are Unix seconds or UTC "YYYY-MM-DDTHH:MM:SS". --text decodes PS
+// (0A/0B), RadioText (2A/2B) and clock time (4A) instead of raw blocks.
+#include "RdsArchive.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+static void print_usage() {
+  std::fprintf(stderr,
+    "Usage: rds_query <dir>\n"
+    "       rds_query <dir> <PI hex> <from> <to> [--text]\n"
+    "  times: Unix seconds or UTC YYYY-MM-DDTHH:MM:SS\n");
+}
+
+static bool parse_time(const char* s, uint64_t* us) {
+  int Y, M, D, h, m, sec;
+  if (std::sscanf(s, "%d-%d-%dT%d:%d:%d", &Y, &M, &D, &h, &m, &sec) == 6) {
+    std::tm tm{};
+    tm.tm_year = Y - 1900;
+    tm.tm_mon = M - 1;
+    tm.tm_mday = D;
+    tm.tm_hour = h;
+    tm.tm_min = m;
+    tm.tm_sec = sec;
+    time_t t = timegm(&tm);
+    if (t < 0) return false;
+    *us = uint64_t(t) * 1000000u;
+    return true;
+  }
+  char* end = nullptr;
+  double v = std::strtod(s, &end);
+  if (end == s || *end != '\0' || v < 0.0) return false;
+  *us = uint64_t(v * 1e6);
+  return true;
+}
+
+static void format_time(uint64_t us, char* out, size_t cap) {
+  time_t t = time_t(us / 1000000u);
+  std::tm tm{};
+  gmtime_r(&t, &tm);
+  size_t n = std::strftime(out, cap, "%Y-%m-%dT%H:%M:%S", &tm);
+  std::snprintf(out + n, cap - n, ".%06uZ", unsigned(us % 1000000u));
+}
+
+static char printable(uint16_t c) { return (c >= 0x20 && c < 0x7F) ? char(c) : ' '; }
+
+// Text of one group, or false if it carries none of PS/RT/CT or a block it
+// needs failed.
+static bool group_text(const RdsGroup& g, char* out, size_t cap) {
+  const uint16_t* b = g.blocks;
+  bool ok_b = !(g.errors & 2), ok_c = !(g.errors & 4), ok_d = !(g.errors & 8);
+  uint8_t type = g.type();
+  if (type == 0 && ok_b && ok_d) {
+    unsigned seg = b[1] & 3;
+    std::snprintf(out, cap, "PS[%u] \"%c%c\"", seg * 2, printable(b[3] >> 8), printable(b[3] & 0xFF));
+    return true;
+  }
+  if (type == 2 && ok_b) {
+    unsigned seg = b[1] & 0xF;
+    if (g.version_b()) {
+      if (!ok_d) return false;
+      std::snprintf(out, cap, "RT[%u] \"%c%c\"", seg * 2, printable(b[3] >> 8), printable(b[3] & 0xFF));
+    } else {
+      if (!ok_c || !ok_d) return false;
+      std::snprintf(out, cap, "RT[%u] \"%c%c%c%c\"", seg * 4, printable(b[2] >> 8), printable(b[2] & 0xFF),
+                    printable(b[3] >> 8), printable(b[3] & 0xFF));
+    }
+    return true;
+  }
+  if (type == 4 && !g.version_b() && ok_b && ok_c && ok_d) {
+    uint32_t mjd = (uint32_t(b[1] & 3) << 15) | (b[2] >> 1);
+    unsigned hour = ((b[2] & 1) << 4) | (b[3] >> 12);
+    unsigned minute = (b[3] >> 6) & 0x3F;
+    int offset = (b[3] & 0x1F) * ((b[3] & 0x20) ? -30 : 30);   // minutes
+    // MJD to calendar date (IEC 62106 annex G)
+    int yp = int((mjd - 15078.2) / 365.25);
+    int mp = int((mjd - 14956.1 - int(yp * 365.25)) / 30.6001);
+    int day = int(mjd) - 14956 - int(yp * 365.25) - int(mp * 30.6001);
+    int k = (mp == 14 || mp == 15) ? 1 : 0;
+    // sign apart: -30 min is "-00:30", which offset / 60 would print as "+00"
+    int mag = std::abs(offset);
+    std::snprintf(out, cap, "CT %04d-%02d-%02d %02u:%02u UTC%c%02d:%02d", 1900 + yp + k, mp - 1 - k * 12, day,
+                  hour, minute, offset < 0 ? '-' : '+', mag / 60, mag % 60);
+    return true;
+  }
+  return false;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 2 && argc != 5 && argc != 6) {
+    print_usage();
+    return 1;
+  }
+  RdsArchiveReader archive(argv[1]);
+
+  if (argc == 2) {
+    auto pis = archive.stations();
+    for (uint16_t pi : pis) std::printf("%04X\n", unsigned(pi));
+    std::fprintf(stderr, "%zu stations\n", pis.size());
+    return 0;
+  }
+
+  char* end = nullptr;
+  unsigned long pi = std::strtoul(argv[2], &end, 16);
+  uint64_t t1 = 0, t2 = 0;
+  bool text = argc == 6 && !std::strcmp(argv[5], "--text");
+  if (*end != '\0' || pi > 0xFFFF || !parse_time(argv[3], &t1) || !parse_time(argv[4], &t2) ||
+      (argc == 6 && !text)) {
+    print_usage();
+    return 1;
+  }
+
+  uint64_t n = 0, bad = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  bool found = archive.query(uint16_t(pi), t1, t2, [&](const RdsRecord& r) {
+    char ts[40], line[64];
+    format_time(r.t_us, ts, sizeof(ts));
+    const RdsGroup& g = r.group;
+    n++;
+    if (g.errors) bad++;
+    if (text) {
+      if (group_text(g, line, sizeof(line))) std::printf("%s %s\n", ts, line);
+      return true;
+    }
+    // errors shown per block, A..D: '.' ok, 'x' failed
+    std::printf("%s %2u%c %04X %04X %04X %04X %c%c%c%c\n", ts, unsigned(g.type()), g.version_b() ? 'B' : 'A',
+                unsigned(g.blocks[0]), unsigned(g.blocks[1]), unsigned(g.blocks[2]), unsigned(g.blocks[3]),
+                (g.errors & 1) ? 'x' : '.', (g.errors & 2) ? 'x' : '.',
+                (g.errors & 4) ? 'x' : '.', (g.errors & 8) ? 'x' : '.');
+    return true;
+  });
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  if (!found) {
+    std::fprintf(stderr, "no archive for PI %04lX in %s\n", pi, argv[1]);
+    return 1;
+  }
+  std::fprintf(stderr, "%llu groups (%llu with block errors) in %.1f ms\n",
+               (unsigned long long)n, (unsigned long long)bad, ms);
+  return 0;
+}
@@ -0,0 +1,113 @@
+// Receives the RTP/L16 stream of fm_relay --rtp and checks it, for loopback
+// tests of RtpSink without a second machine.
+//
+//   rtp_check <port> [--channels N] [--seconds S] [--ptime ms]
+//
+// Listens on 127.0.0.1:<port> until S seconds have passed (default 5) or
+// the stream stops for 1 s after it started. Every packet must be RTP v2
+// with one SSRC, consecutive sequence numbers, a timestamp that advances by
+// the frames of the previous packet, and a payload of whole frames (of
+// exactly ptime when given). Prints a summary and exits non-zero on any
+// violation or when nothing arrived.
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr size_t RTP_HDR = 12;
+
+static void print_usage() {
+  std::fprintf(stderr, "Usage: rtp_check <port> [--channels N] [--seconds S] [--ptime ms]\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    print_usage();
+    return 1;
+  }
+  char* end = nullptr;
+  long port = std::strtol(argv[1], &end, 10);
+  long channels = 1;
+  double seconds = 5.0, ptime_ms = 0.0;
+  bool ok = *end == '\0' && port > 0 && port < 65536;
+  for (int i = 2; ok && i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--channels") && i + 1 < argc) channels = std::strtol(argv[++i], &end, 10);
+    else if (!std::strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = std::strtod(argv[++i], &end);
+    else if (!std::strcmp(argv[i], "--ptime") && i + 1 < argc) ptime_ms = std::strtod(argv[++i], &end);
+    else ok = false;
+    ok = ok && *end == '\0';
+  }
+  if (!ok || channels < 1 || channels > 2 || seconds <= 0.0 || ptime_ms < 0.0) {
+    print_usage();
+    return 1;
+  }
+
+  int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in a{};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(uint16_t(port));
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (fd < 0 || ::bind(fd, reinterpret_cast<sockaddr*>(&a), sizeof(a)) != 0) {
+    std::fprintf(stderr, "cannot bind 127.0.0.1:%ld (%s)\n", port, std::strerror(errno));
+    return 1;
+  }
+
+  const size_t frame_bytes = size_t(channels) * 2;
+  const size_t want_frames = size_t(ptime_ms * 48.0 + 0.5);   // 48 kHz
+  uint64_t packets = 0, frames = 0, errors = 0;
+  uint16_t seq = 0;
+  uint32_t ts = 0, ssrc = 0;
+  using clock = std::chrono::steady_clock;
+  auto t_end = clock::now() + std::chrono::duration<double>(seconds);
+  clock::time_point t_first, t_last;
+
+  uint8_t pkt[65536];
+  while (clock::now() < t_end) {
+    pollfd p{fd, POLLIN, 0};
+    if (::poll(&p, 1, 1000) <= 0) {
+      if (packets) break;   // stream ended
+      continue;
+    }
+    ssize_t n = ::recv(fd, pkt, sizeof(pkt), 0);
+    if (n < 0) continue;
+    t_last = clock::now();
+    size_t payload = n >= ssize_t(RTP_HDR) ? size_t(n) - RTP_HDR : 0;
+    uint16_t s = uint16_t((pkt[2] << 8) | pkt[3]);
+    uint32_t t = (uint32_t(pkt[4]) << 24) | (uint32_t(pkt[5]) << 16) | (uint32_t(pkt[6]) << 8) | pkt[7];
+    uint32_t id = (uint32_t(pkt[8]) << 24) | (uint32_t(pkt[9]) << 16) | (uint32_t(pkt[10]) << 8) | pkt[11];
+    size_t nf = payload / frame_bytes;
+
+    const char* err = nullptr;
+    if (n < ssize_t(RTP_HDR) || (pkt[0] >> 6) != 2) err = "not RTP v2";
+    else if (payload == 0 || payload % frame_bytes) err = "payload is not whole frames";
+    else if (want_frames && nf != want_frames) err = "payload does not match ptime";
+    else if (packets && id != ssrc) err = "SSRC changed";
+    else if (packets && s != uint16_t(seq + 1)) err = "sequence gap";
+    else if (packets && t != ts) err = "timestamp discontinuity";
+    if (err) {
+      if (errors < 10) std::fprintf(stderr, "packet %llu: %s (seq %u ts %u, %zd bytes)\n",
+                                    (unsigned long long)packets, err, unsigned(s), unsigned(t), n);
+      errors++;
+    }
+    if (!packets) t_first = t_last;
+    packets++;
+    frames += nf;
+    seq = s;
+    ssrc = id;
+    ts = t + uint32_t(nf);
+  }
+  ::close(fd);
+
+  double span = std::chrono::duration<double>(t_last - t_first).count();
+  std::printf("%llu packets, %llu frames (%.2f s of audio) over %.2f s, %llu errors\n",
+              (unsigned long long)packets, (unsigned long long)frames, double(frames) / 48000.0, span,
+              (unsigned long long)errors);
+  return (packets == 0 || errors) ? 1 : 0;
+}
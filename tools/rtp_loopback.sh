@@ -0,0 +1,28 @@
+#!/bin/sh
+# Loopback test of the RTP sink: fm_relay on the built-in synth source
+# streams to 127.0.0.1 and rtp_check verifies the packets.
+#
+#   tools/rtp_loopback.sh [build dir] [port]
+#
+# Runs mono, stereo and paced stereo at a 5 ms ptime; exits non-zero on any
+# failure.
+set -e
+BUILD=${1:-build}
+PORT=${2:-50004}
+SECONDS_RUN=4
+
+run() {
+  ch=$1
+  shift
+  "$BUILD/rtp_check" "$PORT" --channels "$ch" --ptime 5 --seconds $((SECONDS_RUN + 5)) &
+  check=$!
+  sleep 0.2
+  "$BUILD/fm_relay" --device synth --seconds "$SECONDS_RUN" --wav /dev/null \
+    --rtp "127.0.0.1:$PORT" --rtp-ptime 5 "$@" >/dev/null 2>&1
+  wait $check
+}
+
+echo "mono:";   run 1
+echo "stereo:"; run 2 --stereo
+echo "stereo, paced:"; run 2 --stereo --rtp-paced
+echo "RTP loopback OK"